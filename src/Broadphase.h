@@ -0,0 +1,168 @@
+#pragma once
+#include "Collision.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Query counters, accumulated until reset by the caller
+struct BroadphaseStats {
+    long long queries = 0;
+    long long cellsVisited = 0;
+    long long candidates = 0;   // Distinct entities handed to the narrow phase
+    long long moves = 0;        // Entities that changed cells in update()
+};
+
+// Uniform grid over world space, stored sparsely as a hash of cell -> ids.
+// Entities are inserted with their bounds once; moving ones call update()
+// each tick, which only touches the cell lists when the covered cells change.
+struct SpatialHash {
+    struct CellRange {
+        int minX, minY, maxX, maxY;
+        bool operator==(const CellRange &o) const {
+            return minX == o.minX && minY == o.minY && maxX == o.maxX && maxY == o.maxY;
+        }
+    };
+
+    float cellSize = 0.5f;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> cells;
+    std::vector<CellRange> ranges;  // Cells covered by each id
+    std::vector<CollisionBox> slack; // World-space extent of those cells; bounds inside it can't change cells
+    std::vector<uint32_t> stamp;    // Last query each id was returned by, for de-duplication
+    uint32_t queryStamp = 0;
+    BroadphaseStats stats;
+
+    void clear() {
+        cells.clear();
+        ranges.clear();
+        slack.clear();
+        stamp.clear();
+        queryStamp = 0;
+    }
+
+    // Ids must be inserted in order 0, 1, 2, ...
+    void insert(uint32_t id, const CollisionBox &bounds) {
+        CellRange range = cellRange(bounds);
+        ranges.push_back(range);
+        slack.push_back(extent(range));
+        stamp.push_back(0);
+        addToCells(id, range);
+    }
+
+    // Move an entity to its new bounds. Cells it has left are only released
+    // once it leaves the whole extent it was registered in, so an entity
+    // pacing across a cell border stops re-linking; queries stay conservative.
+    void update(uint32_t id, const CollisionBox &bounds) {
+        const CollisionBox &s = slack[id];
+        if (bounds.minX >= s.minX && bounds.maxX < s.maxX && bounds.minY >= s.minY && bounds.maxY < s.maxY)
+            return;
+        CellRange range = cellRange(bounds);
+        if (range == ranges[id])
+            return;
+        removeFromCells(id, ranges[id]);
+        addToCells(id, range);
+        ranges[id] = range;
+        slack[id] = extent(range);
+        stats.moves++;
+    }
+
+    // Append the ids whose cells overlap box to out, each once, in ascending order
+    void query(const CollisionBox &box, std::vector<uint32_t> &out) {
+        out.clear();
+        if (++queryStamp == 0) {
+            std::fill(stamp.begin(), stamp.end(), 0);
+            queryStamp = 1;
+        }
+        CellRange range = cellRange(box);
+        for (int cx = range.minX; cx <= range.maxX; cx++) {
+            for (int cy = range.minY; cy <= range.maxY; cy++) {
+                stats.cellsVisited++;
+                auto it = cells.find(key(cx, cy));
+                if (it == cells.end())
+                    continue;
+                for (uint32_t id : it->second) {
+                    if (stamp[id] != queryStamp) {
+                        stamp[id] = queryStamp;
+                        out.push_back(id);
+                    }
+                }
+            }
+        }
+        std::sort(out.begin(), out.end());
+        stats.queries++;
+        stats.candidates += (long long)out.size();
+    }
+
+    CellRange cellRange(const CollisionBox &b) const {
+        return {cell(b.minX), cell(b.minY), cell(b.maxX), cell(b.maxY)};
+    }
+
+    CollisionBox extent(const CellRange &r) const {
+        return {r.minX * cellSize, r.minY * cellSize, (r.maxX + 1) * cellSize, (r.maxY + 1) * cellSize};
+    }
+
+    // floor(v / cellSize) without the libm call; this runs for every moving entity every tick
+    int cell(float v) const {
+        float scaled = v * (1.0f / cellSize);
+        int truncated = (int)scaled;
+        return truncated - (scaled < (float)truncated);
+    }
+
+    static uint64_t key(int cx, int cy) {
+        return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+    }
+
+    void addToCells(uint32_t id, const CellRange &r) {
+        for (int cx = r.minX; cx <= r.maxX; cx++)
+            for (int cy = r.minY; cy <= r.maxY; cy++)
+                cells[key(cx, cy)].push_back(id);
+    }
+
+    void removeFromCells(uint32_t id, const CellRange &r) {
+        for (int cx = r.minX; cx <= r.maxX; cx++) {
+            for (int cy = r.minY; cy <= r.maxY; cy++) {
+                std::vector<uint32_t> &list = cells[key(cx, cy)];
+                auto it = std::find(list.begin(), list.end(), id);
+                if (it != list.end()) {
+                    *it = list.back();
+                    list.pop_back();
+                }
+            }
+        }
+    }
+};
+
+// Narrow-phase scratch: the candidates of one grid query, gathered into
+// packed columns so collideBoxes can test them together
+struct CandidateBoxes {
+    std::vector<uint32_t> ids;
+    std::vector<float> x, y, width, height;
+    std::vector<uint64_t> hits;
+
+    // Query grid around box and test the candidates' current boxes (read
+    // from the store's columns). Returns the number of hits; hit(k) tells
+    // whether ids[k] overlaps.
+    size_t collide(SpatialHash &grid, const CollisionBox &box, const float *storeX, const float *storeY,
+                   const float *storeWidth, const float *storeHeight) {
+        grid.query(box, ids);
+        size_t count = ids.size();
+        x.resize(count);
+        y.resize(count);
+        width.resize(count);
+        height.resize(count);
+        hits.resize(hitWordCount(count));
+        for (size_t k = 0; k < count; k++) {
+            uint32_t id = ids[k];
+            x[k] = storeX[id];
+            y[k] = storeY[id];
+            width[k] = storeWidth[id];
+            height[k] = storeHeight[id];
+        }
+        return collideBoxes(box, x.data(), y.data(), width.data(), height.data(), count, hits.data());
+    }
+
+    bool hit(size_t k) const {
+        return (hits[k >> 6] >> (k & 63)) & 1;
+    }
+};
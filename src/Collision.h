@@ -0,0 +1,185 @@
+#pragma once
+#include "GameObjects.h"
+#include <glm/glm.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// The vector path is picked from GLM's architecture detection, which only
+// reports SIMD when the build defines GLM_FORCE_INTRINSICS (see the Makefile)
+#if (GLM_ARCH & GLM_ARCH_AVX_BIT)
+#include <immintrin.h>
+#define COLLISION_SIMD_WIDTH 8
+#define COLLISION_SIMD_NAME "avx"
+#elif (GLM_ARCH & GLM_ARCH_SSE2_BIT)
+#include <emmintrin.h>
+#define COLLISION_SIMD_WIDTH 4
+#define COLLISION_SIMD_NAME "sse2"
+#else
+#define COLLISION_SIMD_WIDTH 1
+#define COLLISION_SIMD_NAME "scalar"
+#endif
+
+// The player's box as checkCollision sees it: corner plus corner + size
+struct CollisionBox {
+    float minX, minY, maxX, maxY;
+};
+
+// Box centered on (x, y), rounded the same way checkCollision's callers do
+inline CollisionBox centeredBox(float x, float y, float width, float height) {
+    float left = x - width / 2;
+    float bottom = y - height / 2;
+    return {left, bottom, left + width, bottom + height};
+}
+
+// Number of 64-bit hit words needed for count boxes
+inline size_t hitWordCount(size_t count) {
+    return (count + 63) / 64;
+}
+
+// Reference kernel: one box at a time. Bit i of hits is set when box i
+// (centered at x[i], y[i]) overlaps the player box. Returns the hit count.
+size_t collideBoxesScalar(const CollisionBox &box, const float *x, const float *y,
+                          const float *width, const float *height, size_t count, uint64_t *hits)
+{
+    size_t total = 0;
+    for (size_t w = 0; w < hitWordCount(count); w++)
+        hits[w] = 0;
+    for (size_t i = 0; i < count; i++) {
+        float left = x[i] - width[i] / 2;
+        float bottom = y[i] - height[i] / 2;
+        if (box.minX < left + width[i] && box.maxX > left &&
+            box.minY < bottom + height[i] && box.maxY > bottom) {
+            hits[i >> 6] |= (uint64_t)1 << (i & 63);
+            total++;
+        }
+    }
+    return total;
+}
+
+#if COLLISION_SIMD_WIDTH == 8
+// Eight boxes per iteration; same operations as the scalar kernel, so the
+// results are bit-identical
+size_t collideBoxesSimd(const CollisionBox &box, const float *x, const float *y,
+                        const float *width, const float *height, size_t count, uint64_t *hits)
+{
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 minX = _mm256_set1_ps(box.minX), maxX = _mm256_set1_ps(box.maxX);
+    const __m256 minY = _mm256_set1_ps(box.minY), maxY = _mm256_set1_ps(box.maxY);
+    size_t total = 0;
+    for (size_t w = 0; w < hitWordCount(count); w++)
+        hits[w] = 0;
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 w = _mm256_loadu_ps(width + i);
+        __m256 h = _mm256_loadu_ps(height + i);
+        __m256 left = _mm256_sub_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(w, half));
+        __m256 bottom = _mm256_sub_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(h, half));
+        __m256 hit = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(minX, _mm256_add_ps(left, w), _CMP_LT_OQ),
+                          _mm256_cmp_ps(maxX, left, _CMP_GT_OQ)),
+            _mm256_and_ps(_mm256_cmp_ps(minY, _mm256_add_ps(bottom, h), _CMP_LT_OQ),
+                          _mm256_cmp_ps(maxY, bottom, _CMP_GT_OQ)));
+        uint64_t mask = (uint64_t)_mm256_movemask_ps(hit);
+        if (mask) {
+            hits[i >> 6] |= mask << (i & 63);
+            total += (size_t)__builtin_popcountll(mask);
+        }
+    }
+    if (i < count) {
+        uint64_t tail[1];
+        total += collideBoxesScalar(box, x + i, y + i, width + i, height + i, count - i, tail);
+        hits[i >> 6] |= tail[0] << (i & 63);
+    }
+    return total;
+}
+#elif COLLISION_SIMD_WIDTH == 4
+// Four boxes per iteration; same operations as the scalar kernel, so the
+// results are bit-identical
+size_t collideBoxesSimd(const CollisionBox &box, const float *x, const float *y,
+                        const float *width, const float *height, size_t count, uint64_t *hits)
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 minX = _mm_set1_ps(box.minX), maxX = _mm_set1_ps(box.maxX);
+    const __m128 minY = _mm_set1_ps(box.minY), maxY = _mm_set1_ps(box.maxY);
+    size_t total = 0;
+    for (size_t w = 0; w < hitWordCount(count); w++)
+        hits[w] = 0;
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 w = _mm_loadu_ps(width + i);
+        __m128 h = _mm_loadu_ps(height + i);
+        __m128 left = _mm_sub_ps(_mm_loadu_ps(x + i), _mm_mul_ps(w, half));
+        __m128 bottom = _mm_sub_ps(_mm_loadu_ps(y + i), _mm_mul_ps(h, half));
+        __m128 hit = _mm_and_ps(
+            _mm_and_ps(_mm_cmplt_ps(minX, _mm_add_ps(left, w)), _mm_cmpgt_ps(maxX, left)),
+            _mm_and_ps(_mm_cmplt_ps(minY, _mm_add_ps(bottom, h)), _mm_cmpgt_ps(maxY, bottom)));
+        uint64_t mask = (uint64_t)_mm_movemask_ps(hit);
+        if (mask) {
+            hits[i >> 6] |= mask << (i & 63);
+            total += (size_t)__builtin_popcountll(mask);
+        }
+    }
+    if (i < count) {
+        uint64_t tail[1];
+        total += collideBoxesScalar(box, x + i, y + i, width + i, height + i, count - i, tail);
+        hits[i >> 6] |= tail[0] << (i & 63);
+    }
+    return total;
+}
+#else
+size_t collideBoxesSimd(const CollisionBox &box, const float *x, const float *y,
+                        const float *width, const float *height, size_t count, uint64_t *hits)
+{
+    return collideBoxesScalar(box, x, y, width, height, count, hits);
+}
+#endif
+
+// Test the player box against count packed boxes with the widest kernel the
+// build supports. hits must hold hitWordCount(count) words.
+inline size_t collideBoxes(const CollisionBox &box, const float *x, const float *y,
+                           const float *width, const float *height, size_t count, uint64_t *hits)
+{
+    return collideBoxesSimd(box, x, y, width, height, count, hits);
+}
+
+// Time the scalar and vector kernels on the same random boxes and check
+// that they agree
+void runCollisionBenchmark(size_t count)
+{
+    Rng rng(12345);
+    std::vector<float> x(count), y(count), width(count), height(count);
+    for (size_t i = 0; i < count; i++) {
+        x[i] = rng.next01() * 4.0f - 2.0f;
+        y[i] = rng.next01() * 2.0f - 1.0f;
+        width[i] = 0.05f + rng.next01() * 0.4f;
+        height[i] = 0.05f + rng.next01() * 0.2f;
+    }
+    std::vector<uint64_t> scalarHits(hitWordCount(count)), simdHits(hitWordCount(count));
+    CollisionBox player = centeredBox(0.1f, -0.2f, 0.1f, 0.1f);
+
+    const int passes = (int)(20000000 / (count + 1)) + 1;
+    size_t scalarTotal = 0, simdTotal = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++)
+        scalarTotal += collideBoxesScalar(player, x.data(), y.data(), width.data(), height.data(), count, scalarHits.data());
+    auto t1 = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++)
+        simdTotal += collideBoxesSimd(player, x.data(), y.data(), width.data(), height.data(), count, simdHits.data());
+    auto t2 = std::chrono::steady_clock::now();
+
+    double tested = (double)passes * count;
+    double scalarNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / tested;
+    double simdNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / tested;
+    std::cout << "collision: " << count << " boxes x " << passes << " passes, "
+              << scalarTotal / passes << " hits per pass\n"
+              << "collision: scalar " << scalarNs << " ns/box\n"
+              << "collision: " << COLLISION_SIMD_NAME << " (" << COLLISION_SIMD_WIDTH << " wide) "
+              << simdNs << " ns/box, " << (simdNs > 0.0 ? scalarNs / simdNs : 0.0) << "x\n"
+              << "collision: results " << (scalarHits == simdHits && scalarTotal == simdTotal ? "match" : "DIFFER")
+              << std::endl;
+}
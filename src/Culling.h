@@ -0,0 +1,172 @@
+#pragma once
+#include "Collision.h"
+#include "Renderer.h"
+#include "Simulation.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+// Per-frame culling counters, by draw layer
+struct CullStats {
+    int submitted[LAYER_COUNT] = {};
+    int culled[LAYER_COUNT] = {};
+};
+
+// Entities sorted by an x key, each with a padding that bounds how far its
+// drawn extent can reach from the key. A window query binary-searches the
+// keys, so it costs O(log n + candidates) instead of a full scan.
+struct CullIndex {
+    std::vector<float> keys;        // Sorted ascending
+    std::vector<uint32_t> ids;      // Entity behind each key
+    std::vector<uint32_t> position; // Inverse of ids: where each entity sits in key order
+    float maxPad = 0.0f;
+
+    size_t size() const { return ids.size(); }
+
+    void build(const std::vector<float> &x, const std::vector<float> &pad) {
+        ids.resize(x.size());
+        std::iota(ids.begin(), ids.end(), 0u);
+        std::sort(ids.begin(), ids.end(), [&](uint32_t a, uint32_t b) { return x[a] < x[b]; });
+        keys.resize(x.size());
+        position.resize(x.size());
+        maxPad = 0.0f;
+        for (size_t i = 0; i < ids.size(); i++) {
+            keys[i] = x[ids[i]];
+            position[ids[i]] = (uint32_t)i;
+            maxPad = std::max(maxPad, pad[ids[i]]);
+        }
+    }
+
+    // Key-order positions [first, last) of the keys within maxPad of [left, right]
+    void window(float left, float right, size_t &first, size_t &last) const {
+        first = std::lower_bound(keys.begin(), keys.end(), left - maxPad) - keys.begin();
+        last = std::upper_bound(keys.begin() + first, keys.end(), right + maxPad) - keys.begin();
+    }
+
+    // Append every id whose key lies within maxPad of [left, right]
+    void candidates(float left, float right, std::vector<uint32_t> &out) const {
+        size_t first, last;
+        window(left, right, first, last);
+        out.insert(out.end(), ids.begin() + first, ids.begin() + last);
+    }
+};
+
+// Visibility culling for the entity draw passes. Each layer's entities are
+// indexed by x once per level (rebuilt when World::generation changes);
+// every frame the parallax-adjusted camera window is looked up in the index
+// and the candidates are tested against their exact current bounds.
+struct SceneCuller {
+    CullIndex mountains, trees, clouds, platforms, enemies, coins;
+    uint32_t generation = UINT32_MAX;
+    std::vector<uint32_t> visible;
+    CullStats stats;
+
+    // Returns true when the level changed and the indices were rebuilt
+    bool beginFrame(const World &world) {
+        stats = CullStats();
+        if (world.generation == generation)
+            return false;
+        rebuild(world);
+        generation = world.generation;
+        return true;
+    }
+
+    static bool outside(const CollisionBox &b, float left, float right) {
+        return b.maxX < left || b.minX > right || b.maxY < -1.0f || b.minY > 1.0f;
+    }
+
+    // Ids of index entries whose bounds (from bounds(id), in layer space)
+    // overlap the view of a camera at viewX, in ascending id order so draw
+    // order is unchanged
+    template <typename Bounds>
+    const std::vector<uint32_t> &cull(DrawLayer layer, const CullIndex &index, float viewX, Bounds bounds) {
+        const float left = viewX - 1.0f, right = viewX + 1.0f;
+        visible.clear();
+        index.candidates(left, right, visible);
+        visible.erase(std::remove_if(visible.begin(), visible.end(),
+                                     [&](uint32_t id) { return outside(bounds(id), left, right); }),
+                      visible.end());
+        std::sort(visible.begin(), visible.end());
+        stats.submitted[layer] += (int)visible.size();
+        stats.culled[layer] += (int)(index.size() - visible.size());
+        return visible;
+    }
+
+    // For instances kept resident in key order: the one contiguous run of
+    // key-order positions [first, first + count) that covers the view. The
+    // index window is trimmed at both ends by exact bounds; entries inside
+    // the run are drawn even if they miss the view.
+    template <typename Bounds>
+    void cullSlice(DrawLayer layer, const CullIndex &index, float viewX, Bounds bounds, size_t &first, size_t &count) {
+        const float left = viewX - 1.0f, right = viewX + 1.0f;
+        size_t last;
+        index.window(left, right, first, last);
+        while (first < last && outside(bounds(index.ids[first]), left, right))
+            first++;
+        while (last > first && outside(bounds(index.ids[last - 1]), left, right))
+            last--;
+        count = last - first;
+        stats.submitted[layer] += (int)count;
+        stats.culled[layer] += (int)(index.size() - count);
+    }
+
+    // Small, freely moving sets (birds) are tested one by one
+    bool test(DrawLayer layer, float viewX, const CollisionBox &b) {
+        bool inside = !outside(b, viewX - 1.0f, viewX + 1.0f);
+        (inside ? stats.submitted : stats.culled)[layer]++;
+        return inside;
+    }
+
+    // Keys are the entity's x; pads must cover everything drawn for it
+    void rebuild(const World &world) {
+        std::vector<float> x, pad;
+
+        x.clear(); pad.clear();
+        for (const Mountain &mountain : world.mountains) {
+            x.push_back(mountain.x);
+            pad.push_back(mountain.width);
+        }
+        mountains.build(x, pad);
+
+        x.clear(); pad.clear();
+        for (const Tree &tree : world.trees) {
+            x.push_back(tree.x);
+            pad.push_back(tree.size * 0.6f);
+        }
+        trees.build(x, pad);
+
+        x.clear(); pad.clear();
+        for (const Cloud &cloud : world.clouds) {
+            x.push_back(cloud.x);
+            pad.push_back(1.7f * cloud.size);  // Widest lobe, as queueScene bounds it
+        }
+        clouds.build(x, pad);
+
+        x.clear(); pad.clear();
+        for (size_t i = 0; i < world.platforms.size(); i++) {
+            x.push_back(world.platforms.x[i]);
+            pad.push_back(world.platforms.width[i] / 2);
+        }
+        platforms.build(x, pad);
+
+        // Enemies are keyed on the middle of their patrol, padded by its half length
+        x.clear(); pad.clear();
+        const EnemyStore &e = world.enemies;
+        for (size_t i = 0; i < e.size(); i++) {
+            float half = (e.patrolRight[i] - e.patrolLeft[i]) / 2;
+            float reach = e.width[i] * (e.anim[i].baseScale + e.anim[i].zoomAmount) / 2;
+            x.push_back((e.patrolLeft[i] + e.patrolRight[i]) / 2);
+            pad.push_back(half + reach + 0.05f); // Slack for the tick that overshoots before turning
+        }
+        enemies.build(x, pad);
+
+        x.clear(); pad.clear();
+        for (size_t i = 0; i < world.coins.size(); i++) {
+            x.push_back(world.coins.x[i]);
+            pad.push_back(world.coins.width[i]);
+        }
+        coins.build(x, pad);
+    }
+};
@@ -0,0 +1,118 @@
+#pragma once
+#include "glad.h"
+#include "GLState.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Resolution scale limits and controller tuning. Scaling up one step costs
+// at most (0.55 / 0.5)^2 = 1.21x the fill, so a frame that is 20% under
+// target lands under the scale-down threshold after stepping up, and the
+// scale settles instead of oscillating.
+const float RESOLUTION_MIN_SCALE = 0.5f;
+const float RESOLUTION_STEP = 0.05f;
+const float RESOLUTION_SLOW = 1.1f;         // Scale down above 110% of the target frame time
+const float RESOLUTION_FAST = 0.8f;         // Scale up only below 80% of it
+const float RESOLUTION_SMOOTHING = 0.1f;    // Weight of the newest frame in the frame time average
+const int RESOLUTION_COOLDOWN = 30;         // Frames after a change before the next, so the average sees it
+
+// Frame time and scale as of the last frame
+struct ResolutionStats {
+    float scale = 1.0f;
+    int width = 0, height = 0;  // Rendered region, in pixels
+    float frameMs = 0.0f;       // Smoothed
+    float targetMs = 0.0f;
+    int downs = 0, ups = 0;     // Scale changes since start
+};
+
+// Renders the frame into an offscreen target at a fraction of the window's
+// size and upscales it to the window with a linear blit. The fraction follows
+// the smoothed frame time towards a target: down a step when frames run
+// slow, up a step only when they run clearly fast, with a cooldown between
+// steps. The texture stays window-sized; a smaller scale renders into its
+// lower-left corner.
+struct DynamicResolution {
+    unsigned int fbo = 0, texture = 0;
+    int windowWidth = 0, windowHeight = 0;  // Texture size
+    bool usable = false;        // Target complete at the window's size; otherwise frames render to the window
+    int cooldown = 0;
+    ResolutionStats stats;
+
+    void init(float targetFps) {
+        stats.targetMs = 1000.0f / targetFps;
+        stats.frameMs = stats.targetMs;
+        glGenFramebuffers(1, &fbo);
+        glGenTextures(1, &texture);
+    }
+
+    // Start rendering into the target for a window framebuffer of the given
+    // size. A minimized window reports 0x0; the target is kept as it is until
+    // the window comes back.
+    void begin(int framebufferWidth, int framebufferHeight) {
+        bool minimized = framebufferWidth <= 0 || framebufferHeight <= 0;
+        if (!minimized && (framebufferWidth != windowWidth || framebufferHeight != windowHeight))
+            resize(framebufferWidth, framebufferHeight);
+        if (!usable)
+            return;
+        stats.width = std::max(1, (int)std::lround(windowWidth * stats.scale));
+        stats.height = std::max(1, (int)std::lround(windowHeight * stats.scale));
+        glState.bindFramebuffer(fbo);
+        glViewport(0, 0, stats.width, stats.height);
+        // Clears are not limited by the viewport; keep them to the rendered region
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(0, 0, stats.width, stats.height);
+    }
+
+    void resize(int width, int height) {
+        windowWidth = width;
+        windowHeight = height;
+        glState.bindTexture2D(texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glState.bindFramebuffer(fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        usable = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        if (!usable)
+            std::cout << "ERROR::DYNAMIC_RESOLUTION::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        glState.bindFramebuffer(0);
+    }
+
+    // Upscale the rendered region to the window and make it the bound framebuffer again
+    void end() {
+        if (!usable)
+            return;
+        glDisable(GL_SCISSOR_TEST);
+        // The shadow tracks GL_FRAMEBUFFER as a whole; bind both targets to 0
+        // through it, then borrow the read target for the blit
+        glState.bindFramebuffer(0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glBlitFramebuffer(0, 0, stats.width, stats.height, 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT,
+                          GL_LINEAR);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glViewport(0, 0, windowWidth, windowHeight);
+    }
+
+    // Feed the last frame's time, from its start to the end of its swap
+    void update(float frameSeconds) {
+        stats.frameMs += (frameSeconds * 1000.0f - stats.frameMs) * RESOLUTION_SMOOTHING;
+        if (cooldown > 0) {
+            cooldown--;
+            return;
+        }
+        if (stats.frameMs > stats.targetMs * RESOLUTION_SLOW && stats.scale > RESOLUTION_MIN_SCALE) {
+            stats.scale = std::max(RESOLUTION_MIN_SCALE, stats.scale - RESOLUTION_STEP);
+            stats.downs++;
+            cooldown = RESOLUTION_COOLDOWN;
+        } else if (stats.frameMs < stats.targetMs * RESOLUTION_FAST && stats.scale < 1.0f) {
+            stats.scale = std::min(1.0f, stats.scale + RESOLUTION_STEP);
+            stats.ups++;
+            cooldown = RESOLUTION_COOLDOWN;
+        }
+    }
+
+    void destroy() {
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteTextures(1, &texture);
+    }
+};
@@ -0,0 +1,197 @@
+#pragma once
+#include "GameObjects.h"
+#include "LevelFormat.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Packed bit per entity (alive, collected, ...), 64 entities per word
+struct BitSet {
+    std::vector<uint64_t> words;
+    size_t count = 0;
+
+    void clear() {
+        words.clear();
+        count = 0;
+    }
+
+    // n bits, all clear
+    void reset(size_t n) {
+        words.assign((n + 63) / 64, 0);
+        count = n;
+    }
+
+    void push_back(bool value) {
+        if ((count & 63) == 0)
+            words.push_back(0);
+        count++;
+        assign(count - 1, value);
+    }
+
+    bool test(size_t i) const {
+        return (words[i >> 6] >> (i & 63)) & 1;
+    }
+
+    void set(size_t i) {
+        words[i >> 6] |= (uint64_t)1 << (i & 63);
+    }
+
+    void assign(size_t i, bool value) {
+        if (value)
+            set(i);
+        else
+            words[i >> 6] &= ~((uint64_t)1 << (i & 63));
+    }
+
+    // Number of set bits
+    size_t popcount() const {
+        size_t n = 0;
+        for (uint64_t word : words)
+            n += (size_t)__builtin_popcountll(word);
+        return n;
+    }
+};
+
+// Level entities stored as structs of arrays. Collision and update passes
+// walk only the arrays they read; the Platform/Enemy/Coin structs remain as
+// spawn descriptors that add() splits into columns; assign() copies whole
+// columns from a level, append() adds them after the entities already held.
+
+// Platforms: geometry, plus the rest height the float wave moves y around.
+// Every platform rides the same wave of World::worldTime; only the
+// simulation reads y, drawing evaluates the wave on the GPU.
+struct PlatformStore {
+    std::vector<float> x, y, width, height;
+    std::vector<float> initialY;
+
+    size_t size() const { return x.size(); }
+
+    void clear() {
+        for (std::vector<float> *column : {&x, &y, &width, &height, &initialY})
+            column->clear();
+    }
+
+    void add(const Platform &p) {
+        x.push_back(p.x);
+        y.push_back(p.y);
+        width.push_back(p.width);
+        height.push_back(p.height);
+        initialY.push_back(p.initialY);
+    }
+
+    void assign(const LevelColumns &level) {
+        x.assign(level[PLATFORM_X], level[PLATFORM_X] + level.count);
+        y.assign(level[PLATFORM_Y], level[PLATFORM_Y] + level.count);
+        width.assign(level[PLATFORM_WIDTH], level[PLATFORM_WIDTH] + level.count);
+        height.assign(level[PLATFORM_HEIGHT], level[PLATFORM_HEIGHT] + level.count);
+        initialY = y;
+    }
+
+    void append(const LevelColumns &level) {
+        x.insert(x.end(), level[PLATFORM_X], level[PLATFORM_X] + level.count);
+        y.insert(y.end(), level[PLATFORM_Y], level[PLATFORM_Y] + level.count);
+        width.insert(width.end(), level[PLATFORM_WIDTH], level[PLATFORM_WIDTH] + level.count);
+        height.insert(height.end(), level[PLATFORM_HEIGHT], level[PLATFORM_HEIGHT] + level.count);
+        initialY.insert(initialY.end(), level[PLATFORM_Y], level[PLATFORM_Y] + level.count);
+    }
+};
+
+// Zoom animation parameters of an enemy; only read when drawing
+struct EnemyAnim {
+    float baseScale;
+    float zoomAmount;
+    float zoomSpeed;
+};
+
+// Enemies: hot patrol/collision columns, cold animation records
+struct EnemyStore {
+    std::vector<float> x, y, width, height;
+    std::vector<float> velocity, patrolLeft, patrolRight, prevX;
+    std::vector<EnemyAnim> anim;
+
+    size_t size() const { return x.size(); }
+
+    void clear() {
+        for (std::vector<float> *column : {&x, &y, &width, &height, &velocity, &patrolLeft, &patrolRight, &prevX})
+            column->clear();
+        anim.clear();
+    }
+
+    void add(const Enemy &e) {
+        x.push_back(e.x);
+        y.push_back(e.y);
+        width.push_back(e.width);
+        height.push_back(e.height);
+        velocity.push_back(e.velocity);
+        patrolLeft.push_back(e.patrolLeft);
+        patrolRight.push_back(e.patrolRight);
+        prevX.push_back(e.prevX);
+        anim.push_back({e.baseScale, e.zoomAmount, e.zoomSpeed});
+    }
+
+    void assign(const LevelColumns &level) {
+        x.assign(level[ENEMY_X], level[ENEMY_X] + level.count);
+        y.assign(level[ENEMY_Y], level[ENEMY_Y] + level.count);
+        width.assign(level[ENEMY_WIDTH], level[ENEMY_WIDTH] + level.count);
+        height.assign(level[ENEMY_HEIGHT], level[ENEMY_HEIGHT] + level.count);
+        velocity.assign(level[ENEMY_VELOCITY], level[ENEMY_VELOCITY] + level.count);
+        patrolLeft.assign(level[ENEMY_PATROL_LEFT], level[ENEMY_PATROL_LEFT] + level.count);
+        patrolRight.assign(level[ENEMY_PATROL_RIGHT], level[ENEMY_PATROL_RIGHT] + level.count);
+        prevX = x;
+        anim.resize(level.count);
+        for (size_t i = 0; i < level.count; i++)
+            anim[i] = {level[ENEMY_BASE_SCALE][i], level[ENEMY_ZOOM_AMOUNT][i], level[ENEMY_ZOOM_SPEED][i]};
+    }
+
+    void append(const LevelColumns &level) {
+        x.insert(x.end(), level[ENEMY_X], level[ENEMY_X] + level.count);
+        y.insert(y.end(), level[ENEMY_Y], level[ENEMY_Y] + level.count);
+        width.insert(width.end(), level[ENEMY_WIDTH], level[ENEMY_WIDTH] + level.count);
+        height.insert(height.end(), level[ENEMY_HEIGHT], level[ENEMY_HEIGHT] + level.count);
+        velocity.insert(velocity.end(), level[ENEMY_VELOCITY], level[ENEMY_VELOCITY] + level.count);
+        patrolLeft.insert(patrolLeft.end(), level[ENEMY_PATROL_LEFT], level[ENEMY_PATROL_LEFT] + level.count);
+        patrolRight.insert(patrolRight.end(), level[ENEMY_PATROL_RIGHT], level[ENEMY_PATROL_RIGHT] + level.count);
+        prevX.insert(prevX.end(), level[ENEMY_X], level[ENEMY_X] + level.count);
+        for (size_t i = 0; i < level.count; i++)
+            anim.push_back({level[ENEMY_BASE_SCALE][i], level[ENEMY_ZOOM_AMOUNT][i], level[ENEMY_ZOOM_SPEED][i]});
+    }
+};
+
+// Coins: geometry and a collected bit each
+struct CoinStore {
+    std::vector<float> x, y, width, height;
+    BitSet collected;
+
+    size_t size() const { return x.size(); }
+
+    void clear() {
+        for (std::vector<float> *column : {&x, &y, &width, &height})
+            column->clear();
+        collected.clear();
+    }
+
+    void add(const Coin &c) {
+        x.push_back(c.x);
+        y.push_back(c.y);
+        width.push_back(c.width);
+        height.push_back(c.height);
+        collected.push_back(c.collected);
+    }
+
+    void assign(const LevelColumns &level) {
+        x.assign(level[COIN_X], level[COIN_X] + level.count);
+        y.assign(level[COIN_Y], level[COIN_Y] + level.count);
+        width.assign(level[COIN_WIDTH], level[COIN_WIDTH] + level.count);
+        height.assign(level[COIN_HEIGHT], level[COIN_HEIGHT] + level.count);
+        collected.reset(level.count);
+    }
+
+    void append(const LevelColumns &level) {
+        x.insert(x.end(), level[COIN_X], level[COIN_X] + level.count);
+        y.insert(y.end(), level[COIN_Y], level[COIN_Y] + level.count);
+        width.insert(width.end(), level[COIN_WIDTH], level[COIN_WIDTH] + level.count);
+        height.insert(height.end(), level[COIN_HEIGHT], level[COIN_HEIGHT] + level.count);
+        for (size_t i = 0; i < level.count; i++)
+            collected.push_back(false);
+    }
+};
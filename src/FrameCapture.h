@@ -0,0 +1,333 @@
+#pragma once
+#include "glad.h"
+#include "GLState.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Capture counters, cumulative since start()
+struct CaptureStats {
+    long long frames = 0;           // Read back or submitted, and queued for writing
+    long long written = 0;          // Written to disk by the writer thread
+    long long stalls = 0;           // Frames whose readback was not ready when its slot was reused
+    long long writerWaits = 0;      // Frames the render thread waited on a full writer queue
+    double renderSeconds = 0.0;     // Render-thread time spent in capture() or submit()
+    double writerSeconds = 0.0;     // Writer-thread time spent converting and writing
+    size_t bytes = 0;               // Bytes written
+};
+
+// One read-back frame, RGBA, bottom row first as GL returns it
+struct CapturedFrame {
+    std::vector<uint8_t> pixels;
+    long long index = 0;
+};
+
+// Records frames to disk without stalling the render loop. capture() issues
+// glReadPixels into one of a ring of pixel pack buffers and fences it; the
+// slot is only mapped when it comes round again, PBO_COUNT frames later,
+// by which time the GPU has long finished the copy. Mapped pixels are
+// handed to a writer thread that converts them and streams them to disk.
+//
+// A path ending in .y4m is written as one YUV4MPEG2 (4:2:0, full range)
+// video; any other path is a prefix for one binary PPM per frame,
+// <path>_00000.ppm onwards. Frames rendered on the CPU skip the readback
+// and go straight to the writer through submit().
+struct FrameCapture {
+    static const int PBO_COUNT = 3;
+    static const size_t MAX_QUEUED = 8;     // Frames waiting for the writer before capture() blocks
+
+    unsigned int pbos[PBO_COUNT] = {};
+    GLsync fences[PBO_COUNT] = {};
+    long long slotFrame[PBO_COUNT] = {};
+    int next = 0;
+    int width = 0, height = 0;
+    std::string path;
+    bool video = false;
+    int frameRate = 60;
+    FILE *out = nullptr;
+    CaptureStats stats;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable ready;      // Writer: a frame was queued or capture stopped
+    std::condition_variable drained;    // Render thread: the queue has room again
+    std::deque<CapturedFrame> queue;
+    std::vector<std::vector<uint8_t>> pool;     // Buffers of written frames, reused
+    bool stopping = false;
+
+    bool active() const {
+        return !path.empty();
+    }
+
+    // Capture width x height pixels from the lower left corner; the size is
+    // fixed for the whole capture. fps is the video's nominal frame rate.
+    bool start(const std::string &outputPath, int captureWidth, int captureHeight, int fps) {
+        path = outputPath;
+        width = captureWidth;
+        height = captureHeight;
+        frameRate = fps > 0 ? fps : 60;
+        video = path.size() > 4 && path.compare(path.size() - 4, 4, ".y4m") == 0;
+        if (video) {
+            out = std::fopen(path.c_str(), "wb");
+            if (!out) {
+                std::cout << "ERROR::CAPTURE::CANNOT_WRITE " << path << std::endl;
+                path.clear();
+                return false;
+            }
+            std::fprintf(out, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, frameRate);
+        }
+
+        stopping = false;
+        writer = std::thread(&FrameCapture::writeLoop, this);
+        return true;
+    }
+
+    // Read back the finished frame in framebuffer (0 = the default one); call
+    // after the frame's draws and before swapping
+    void capture(unsigned int framebuffer = 0) {
+        if (!active())
+            return;
+        auto t0 = std::chrono::steady_clock::now();
+        if (!pbos[0]) {
+            glGenBuffers(PBO_COUNT, pbos);
+            for (int i = 0; i < PBO_COUNT; i++) {
+                glState.bindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+                glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)width * height * 4, NULL, GL_STREAM_READ);
+            }
+        }
+
+        // The slot's previous readback, PBO_COUNT frames old, goes to the writer first
+        if (fences[next])
+            collect(next);
+
+        const unsigned int drawing = glState.framebuffer;
+        glState.bindFramebuffer(framebuffer);
+        glState.bindBuffer(GL_PIXEL_PACK_BUFFER, pbos[next]);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void *)0);
+        glState.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glState.bindFramebuffer(drawing);
+        fences[next] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slotFrame[next] = stats.frames++;
+        next = (next + 1) % PBO_COUNT;
+
+        stats.renderSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    // Map slot's pixels once its fence has signalled and queue a copy for the writer
+    void collect(int slot) {
+        if (glClientWaitSync(fences[slot], 0, 0) == GL_TIMEOUT_EXPIRED) {
+            stats.stalls++;
+            glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+        }
+        glDeleteSync(fences[slot]);
+        fences[slot] = 0;
+
+        CapturedFrame frame = takeFrame(slotFrame[slot]);
+        glState.bindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+        const void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frame.pixels.size(), GL_MAP_READ_BIT);
+        if (mapped) {
+            std::copy((const uint8_t *)mapped, (const uint8_t *)mapped + frame.pixels.size(), frame.pixels.begin());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glState.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (mapped)
+            queueFrame(std::move(frame));
+    }
+
+    // Queue a frame rendered on the CPU: width x height RGBA8, bottom row first
+    void submit(const uint8_t *rgba) {
+        if (!active())
+            return;
+        auto t0 = std::chrono::steady_clock::now();
+        CapturedFrame frame = takeFrame(stats.frames++);
+        std::copy(rgba, rgba + frame.pixels.size(), frame.pixels.begin());
+        queueFrame(std::move(frame));
+        stats.renderSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    // A frame buffer from the pool, once the writer queue has room
+    CapturedFrame takeFrame(long long index) {
+        CapturedFrame frame;
+        frame.index = index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (queue.size() >= MAX_QUEUED) {
+                stats.writerWaits++;
+                drained.wait(lock, [this] { return queue.size() < MAX_QUEUED; });
+            }
+            if (!pool.empty()) {
+                frame.pixels.swap(pool.back());
+                pool.pop_back();
+            }
+        }
+        frame.pixels.resize((size_t)width * height * 4);
+        return frame;
+    }
+
+    void queueFrame(CapturedFrame &&frame) {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(frame));
+        ready.notify_one();
+    }
+
+    // Drain the ring in frame order, stop the writer and close the output
+    void finish() {
+        if (!active())
+            return;
+        for (int i = 0; i < PBO_COUNT; i++) {
+            int slot = (next + i) % PBO_COUNT;
+            if (fences[slot])
+                collect(slot);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            ready.notify_one();
+        }
+        writer.join();
+        if (out)
+            std::fclose(out);
+        out = nullptr;
+        if (pbos[0])
+            glDeleteBuffers(PBO_COUNT, pbos);
+
+        std::cout << "\ncapture: " << stats.written << " frames (" << width << "x" << height << ") to " << path
+                  << ", " << stats.bytes / (1024 * 1024) << " MiB\n"
+                  << "capture: render thread " << renderMsPerFrame() << " ms/frame, "
+                  << stats.stalls << " readback stalls, " << stats.writerWaits << " waits on the writer\n"
+                  << "capture: writer " << (stats.written ? stats.writerSeconds * 1000.0 / stats.written : 0.0)
+                  << " ms/frame" << std::endl;
+        path.clear();
+    }
+
+    double renderMsPerFrame() const {
+        return stats.frames ? stats.renderSeconds * 1000.0 / stats.frames : 0.0;
+    }
+
+    // Copy of the counters the writer thread updates too
+    CaptureStats snapshot() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    // Writer thread: convert and write queued frames until finish() stops it
+    void writeLoop() {
+        std::vector<uint8_t> encoded;
+        for (;;) {
+            CapturedFrame frame;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty())
+                    return;
+                frame = std::move(queue.front());
+                queue.pop_front();
+                drained.notify_one();
+            }
+
+            auto t0 = std::chrono::steady_clock::now();
+            bool ok;
+            if (video) {
+                encodeYUV420(frame.pixels, encoded);
+                ok = std::fwrite("FRAME\n", 1, 6, out) == 6 &&
+                     std::fwrite(encoded.data(), 1, encoded.size(), out) == encoded.size();
+            } else {
+                encodePPM(frame.pixels, encoded);
+                char name[32];
+                std::snprintf(name, sizeof(name), "_%05lld.ppm", frame.index);
+                FILE *file = std::fopen((path + name).c_str(), "wb");
+                ok = file && std::fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+                if (file)
+                    std::fclose(file);
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ok) {
+                stats.written++;
+                stats.bytes += encoded.size();
+            } else if (stats.written == 0) {
+                std::cout << "ERROR::CAPTURE::WRITE_FAILED " << path << std::endl;
+            }
+            stats.writerSeconds += seconds;
+            pool.push_back(std::move(frame.pixels));
+        }
+    }
+
+    // Binary PPM, top row first
+    void encodePPM(const std::vector<uint8_t> &rgba, std::vector<uint8_t> &ppm) const {
+        char header[32];
+        int headerSize = std::snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+        ppm.resize(headerSize + (size_t)width * height * 3);
+        std::copy(header, header + headerSize, ppm.begin());
+        uint8_t *dst = ppm.data() + headerSize;
+        for (int y = height - 1; y >= 0; y--) {
+            const uint8_t *src = rgba.data() + (size_t)y * width * 4;
+            for (int x = 0; x < width; x++, src += 4) {
+                *dst++ = src[0];
+                *dst++ = src[1];
+                *dst++ = src[2];
+            }
+        }
+    }
+
+    // Y plane then 2x2-averaged Cb and Cr planes, top row first, BT.601 full range
+    void encodeYUV420(const std::vector<uint8_t> &rgba, std::vector<uint8_t> &yuv) const {
+        const int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+        yuv.resize((size_t)width * height + 2 * (size_t)chromaWidth * chromaHeight);
+        uint8_t *luma = yuv.data();
+        uint8_t *cb = luma + (size_t)width * height;
+        uint8_t *cr = cb + (size_t)chromaWidth * chromaHeight;
+
+        // 16.16 fixed point coefficients
+        for (int y = 0; y < height; y++) {
+            const uint8_t *src = rgba.data() + (size_t)(height - 1 - y) * width * 4;
+            for (int x = 0; x < width; x++, src += 4)
+                *luma++ = (uint8_t)((19595 * src[0] + 38470 * src[1] + 7471 * src[2] + 32768) >> 16);
+        }
+        for (int cy = 0; cy < chromaHeight; cy++) {
+            for (int cx = 0; cx < chromaWidth; cx++) {
+                int r = 0, g = 0, b = 0, n = 0;
+                for (int y = cy * 2; y < cy * 2 + 2 && y < height; y++) {
+                    for (int x = cx * 2; x < cx * 2 + 2 && x < width; x++) {
+                        const uint8_t *p = rgba.data() + ((size_t)(height - 1 - y) * width + x) * 4;
+                        r += p[0];
+                        g += p[1];
+                        b += p[2];
+                        n++;
+                    }
+                }
+                r /= n;
+                g /= n;
+                b /= n;
+                *cb++ = (uint8_t)std::min(255, (-11059 * r - 21709 * g + 32768 * b + (128 << 16) + 32768) >> 16);
+                *cr++ = (uint8_t)std::min(255, (32768 * r - 27439 * g - 5329 * b + (128 << 16) + 32768) >> 16);
+            }
+        }
+    }
+};
+
+// Read a binary PPM as FrameCapture writes them: RGB, top row first
+bool readPPM(const std::string &path, int &width, int &height, std::vector<uint8_t> &rgb)
+{
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    int maxValue = 0;
+    bool ok = std::fscanf(file, "P6 %d %d %d", &width, &height, &maxValue) == 3 && maxValue == 255 &&
+              width > 0 && height > 0 && std::fgetc(file) != EOF;
+    if (ok) {
+        rgb.resize((size_t)width * height * 3);
+        ok = std::fread(rgb.data(), 1, rgb.size(), file) == rgb.size();
+    }
+    std::fclose(file);
+    return ok;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "glad.h"
+#include <cstdint>
+#include <unordered_map>
+
+// GL calls routed through GLState this frame
+struct GLStateStats {
+    int issued = 0;     // Reached the driver
+    int skipped = 0;    // Would have set what was already bound
+};
+
+// Shadow copy of the binds the renderers make: program, VAO, array and
+// uniform buffers, framebuffer, texture unit 0 and int uniforms. A bind
+// that matches the shadow is skipped. Every bind of these kinds must go
+// through here, or the shadow goes stale; ELEMENT_ARRAY_BUFFER is VAO
+// state and is bound directly.
+struct GLState {
+    unsigned int program = 0;
+    unsigned int vao = 0;
+    unsigned int arrayBuffer = 0;
+    unsigned int uniformBuffer = 0;
+    unsigned int framebuffer = 0;
+    unsigned int activeTexture = GL_TEXTURE0;
+    unsigned int texture2D = 0;         // On GL_TEXTURE0
+    std::unordered_map<uint64_t, int> uniformInts;  // (program, location) -> value
+    GLStateStats stats;
+
+    void beginFrame() {
+        stats = GLStateStats();
+    }
+
+    // Record the value of a cached bind; true when the call must be issued
+    template <typename T> bool change(T &current, T value, int calls = 1) {
+        if (current == value) {
+            stats.skipped += calls;
+            return false;
+        }
+        current = value;
+        stats.issued += calls;
+        return true;
+    }
+
+    void useProgram(unsigned int p) {
+        if (change(program, p))
+            glUseProgram(p);
+    }
+
+    void bindVertexArray(unsigned int v) {
+        if (change(vao, v))
+            glBindVertexArray(v);
+    }
+
+    void bindBuffer(GLenum target, unsigned int buffer) {
+        if (target == GL_ARRAY_BUFFER) {
+            if (change(arrayBuffer, buffer))
+                glBindBuffer(target, buffer);
+        } else if (target == GL_UNIFORM_BUFFER) {
+            if (change(uniformBuffer, buffer))
+                glBindBuffer(target, buffer);
+        } else {
+            glBindBuffer(target, buffer);
+            stats.issued++;
+        }
+    }
+
+    // Also binds the buffer to the generic GL_UNIFORM_BUFFER target
+    void bindBufferBase(GLenum target, unsigned int index, unsigned int buffer) {
+        glBindBufferBase(target, index, buffer);
+        stats.issued++;
+        if (target == GL_UNIFORM_BUFFER)
+            uniformBuffer = buffer;
+    }
+
+    void bindFramebuffer(unsigned int fbo) {
+        if (change(framebuffer, fbo))
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    }
+
+    void bindTexture2D(unsigned int texture) {
+        if (change(activeTexture, (unsigned int)GL_TEXTURE0))
+            glActiveTexture(GL_TEXTURE0);
+        if (change(texture2D, texture))
+            glBindTexture(GL_TEXTURE_2D, texture);
+    }
+
+    // Int uniform of the current program
+    void uniform1i(int location, int value) {
+        if (location < 0)
+            return;
+        uint64_t key = ((uint64_t)program << 32) | (uint32_t)location;
+        auto it = uniformInts.find(key);
+        if (it != uniformInts.end() && it->second == value) {
+            stats.skipped++;
+            return;
+        }
+        uniformInts[key] = value;
+        glUniform1i(location, value);
+        stats.issued++;
+    }
+};
+
+// The context's one state shadow, shared by every renderer
+GLState glState;
@@ -4,10 +4,21 @@
 const unsigned int SCR_WIDTH = 800;    // Increased from 1024 to 1280 for wider view
 const unsigned int SCR_HEIGHT = 600;    // Reduced from default height
 
-// Game physics
-const float GRAVITY = 0.000013f;         
-const float JUMP_FORCE = 0.005f;       // Reduced from 0.005f to 0.015f for more reasonable jump height
-const float MOVEMENT_SPEED = 0.0009f;   
+// Game physics, in world units per second. These match the old per-frame
+// values at the ~1000 FPS the uncapped loop used to run at.
+const float GRAVITY = 13.0f;           // Units per second squared
+const float JUMP_FORCE = 5.0f;         // Initial jump velocity
+const float MOVEMENT_SPEED = 0.9f;
+const float ENEMY_SPEED = 0.09f;
+const float PLATFORM_FLOAT_AMPLITUDE = 0.03f;  // Platforms and trees bob this far up and down
+const float PLATFORM_FLOAT_SPEED = 2.0f;       // Radians per second of the bobbing wave
+
+// Horizontal camera factor of the parallax background layers
+const float MOUNTAIN_PARALLAX = 0.5f;
+const float TREE_PARALLAX = 0.7f;
+
+// Simulation rate; rendering interpolates between ticks
+const float SIM_TICK_RATE = 120.0f;
 
 // Game state
 const float LEVEL_END_X = 2.0f;         // Keeping level length the same
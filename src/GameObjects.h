@@ -1,7 +1,33 @@
 #pragma once
 #include <vector>
+#include <cstdint>
+#include "GameConstants.h"
 #include <glm/glm.hpp> // Include GLM for glm::vec4
 
+// Small seedable generator (xorshift32) so a world built from the same seed
+// is identical on every run; replaces rand() for everything the simulation sees
+struct Rng {
+    uint32_t state = 0x9e3779b9u;
+
+    explicit Rng(uint32_t seed = 1) { reseed(seed); }
+
+    void reseed(uint32_t seed) {
+        state = seed ? seed : 0x9e3779b9u; // xorshift must not start at zero
+    }
+
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // Uniform in [0, 1]
+    float next01() {
+        return (next() >> 8) * (1.0f / 16777215.0f);
+    }
+};
+
 // Player state
 struct Player {
     float x = -0.8f;
@@ -9,6 +35,8 @@ struct Player {
     float width = 0.1f;
     float height = 0.1f;
     float velocityY = 0.0f;
+    float prevX = -0.8f;    // Position at the previous tick, for interpolation
+    float prevY = -0.3f;
     bool isJumping = false;
     bool facingRight = true;
     
@@ -24,10 +52,9 @@ struct Platform {
     float width;
     float height;
     float initialY;     // Store initial Y position
-    float floatTimer;   // Timer for floating animation
     
     Platform(float _x, float _y, float _w, float _h) 
-        : x(_x), y(_y), width(_w), height(_h), initialY(_y), floatTimer(0.0f) {}
+        : x(_x), y(_y), width(_w), height(_h), initialY(_y) {}
 };
 
 // Modified Enemy struct
@@ -36,20 +63,21 @@ struct Enemy {
     float y;
     float width;
     float height;
-    float velocity;
+    float velocity;     // Units per second
     float patrolLeft;
     float patrolRight;
+    float prevX;        // X at the previous tick, for interpolation
     
-    // Add these new variables for zoom animation
-    float scaleTimer = 0.0f;
+    // Zoom animation, evaluated by the instanced shader
     float baseScale = 1.0f;
     float zoomAmount = 0.2f;    // How much it zooms (20%)
     float zoomSpeed = 2.0f;     // Speed of zoom animation
     
     Enemy(float _x, float _y) : x(_x), y(_y), width(0.08f), height(0.08f), 
-           velocity(0.00009f), 
+           velocity(ENEMY_SPEED), 
            patrolLeft(_x - 0.8f),
-           patrolRight(_x + 0.8f) {} 
+           patrolRight(_x + 0.8f),
+           prevX(_x) {} 
 };
 
 
@@ -77,20 +105,22 @@ struct Flag {
 struct Cloud {
     float x, y;
     float size;
-    float bounceOffset;  // For vertical bouncing
+    float bounceOffset;  // Phase of the vertical bounce, animated by the instanced shader
     
-    Cloud(float _x, float _y) 
-        : x(_x), y(_y), size(0.1f), bounceOffset(static_cast<float>(rand()) / RAND_MAX * 6.28f) {}
+    Cloud(float _x, float _y, Rng &rng) 
+        : x(_x), y(_y), size(0.1f), bounceOffset(rng.next01() * 6.28f) {}
+    Cloud(float _x, float _y, float _size, float phase)
+        : x(_x), y(_y), size(_size), bounceOffset(phase) {}
 };
 
 struct Bird {
     float x, y;
     float speed;
-    float angle;
     bool movingRight;
+    float prevX;         // X at the previous tick, for interpolation; the sine flight is animated on the GPU
 
     // Reduced speed significantly for smoother movement
-    Bird(float _x, float _y) : x(_x), y(_y), speed(0.0002f), angle(0.0f), movingRight(true) {}
+    Bird(float _x, float _y) : x(_x), y(_y), speed(0.0002f), movingRight(true), prevX(_x) {}
 };
 
 struct Mountain {
@@ -111,11 +141,11 @@ struct Star {
     float twinkleSpeed;
     float twinklePhase;
     
-    Star(float _x, float _y) 
+    Star(float _x, float _y, Rng &rng) 
         : x(_x), y(_y), 
-          size(0.005f + static_cast<float>(rand())/RAND_MAX * 0.005f),
-          twinkleSpeed(1.0f + static_cast<float>(rand())/RAND_MAX * 2.0f),
-          twinklePhase(static_cast<float>(rand())/RAND_MAX * 6.28f) {}
+          size(0.005f + rng.next01() * 0.005f),
+          twinkleSpeed(1.0f + rng.next01() * 2.0f),
+          twinklePhase(rng.next01() * 6.28f) {}
 };
 
 struct GrassTuft {
@@ -129,12 +159,10 @@ struct GrassTuft {
 
 struct Tree {
     float x, y;
-    float size;
-    float initialY;     // Store initial Y position
-    float floatTimer;   // Timer for floating animation
+    float size;         // Bobbing is evaluated by the instanced shader
     
     Tree(float x, float y, float size) 
-        : x(x), y(y), size(size), initialY(y), floatTimer(0.0f) {}
+        : x(x), y(y), size(size) {}
 };
 
 struct Sun {
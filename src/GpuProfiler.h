@@ -0,0 +1,156 @@
+#pragma once
+#include "glad.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// Render passes timed on the GPU, in draw order
+enum GpuPass {
+    GPU_PASS_BACKGROUND = 0,    // Clear, mountains and trees, sun, clouds, birds
+    GPU_PASS_OBJECTS,           // Platforms, enemies and coins
+    GPU_PASS_FLAG_PLAYER,
+    GPU_PASS_UPSCALE,           // Dynamic resolution's blit to the window
+    GPU_PASS_READBACK,          // Frame capture's copy into its pixel buffer
+    GPU_PASS_COUNT
+};
+
+const char *const gpuPassNames[GPU_PASS_COUNT] = {"background", "objects", "flag_player", "upscale",
+                                                    "readback"};
+
+// Per-pass GPU time, averaged over the profiler's window
+struct GpuTimings {
+    double ms[GPU_PASS_COUNT] = {};
+    double totalMs = 0.0;
+    int frames = 0;             // Frames in the average
+    long long resolved = 0;     // Frames timed since start
+    long long dropped = 0;      // Frames left untimed because their queries were still in flight
+};
+
+// Times each pass with a GL_TIME_ELAPSED query. Each frame's queries go into
+// one slot of a ring and are read back when the slot comes round again,
+// FRAMES frames later, so the results are normally long available. A slot
+// still in flight is never waited on: the frame goes untimed instead.
+//
+// Passes run one after another (elapsed-time queries cannot nest); begin()
+// closes the open pass.
+struct GpuProfiler {
+    static constexpr int FRAMES = 3;
+    static constexpr int WINDOW = 60;   // Resolved frames averaged, and frames per CSV row
+
+    unsigned int queries[FRAMES][GPU_PASS_COUNT] = {};
+    bool issued[FRAMES][GPU_PASS_COUNT] = {};
+    bool pending[FRAMES] = {};      // Slot holds queries not read back yet
+    int slot = 0;
+    bool timing = false;            // This frame's slot was free
+    int active = -1;                // Pass whose query is open
+
+    double window[WINDOW][GPU_PASS_COUNT] = {};
+    double sums[GPU_PASS_COUNT] = {};
+    int windowFrames = 0, windowNext = 0;
+    long long resolved = 0, dropped = 0;
+    std::ofstream csv;
+
+    // csvPath, if not empty, receives one row of window averages every WINDOW timed frames
+    void init(const std::string &csvPath) {
+        glGenQueries(FRAMES * GPU_PASS_COUNT, &queries[0][0]);
+        if (csvPath.empty())
+            return;
+        csv.open(csvPath);
+        if (!csv) {
+            std::cout << "ERROR::GPU_PROFILER::CANNOT_WRITE " << csvPath << std::endl;
+            return;
+        }
+        csv << "frame";
+        for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+            csv << "," << gpuPassNames[pass] << "_ms";
+        csv << ",total_ms" << std::endl;
+    }
+
+    // Move to the next slot, reading back its previous frame if the GPU is done with it
+    void beginFrame() {
+        end();
+        slot = (slot + 1) % FRAMES;
+        if (pending[slot] && resolve(slot))
+            pending[slot] = false;
+        timing = !pending[slot];
+        if (!timing)
+            dropped++;
+        std::fill(issued[slot], issued[slot] + GPU_PASS_COUNT, false);
+    }
+
+    void begin(GpuPass pass) {
+        end();
+        if (!timing)
+            return;
+        glBeginQuery(GL_TIME_ELAPSED, queries[slot][pass]);
+        issued[slot][pass] = true;
+        active = pass;
+    }
+
+    void end() {
+        if (active < 0)
+            return;
+        glEndQuery(GL_TIME_ELAPSED);
+        active = -1;
+    }
+
+    void endFrame() {
+        end();
+        if (timing)
+            pending[slot] = true;
+    }
+
+    // Read a slot's results into the window; false if any is not available yet
+    bool resolve(int index) {
+        for (int pass = 0; pass < GPU_PASS_COUNT; pass++) {
+            GLuint available = GL_TRUE;
+            if (issued[index][pass])
+                glGetQueryObjectuiv(queries[index][pass], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                return false;
+        }
+        for (int pass = 0; pass < GPU_PASS_COUNT; pass++) {
+            GLuint64 nanoseconds = 0;
+            if (issued[index][pass])
+                glGetQueryObjectui64v(queries[index][pass], GL_QUERY_RESULT, &nanoseconds);
+            sums[pass] -= window[windowNext][pass];
+            window[windowNext][pass] = nanoseconds / 1.0e6;
+            sums[pass] += window[windowNext][pass];
+        }
+        windowNext = (windowNext + 1) % WINDOW;
+        windowFrames = std::min(windowFrames + 1, WINDOW);
+        resolved++;
+        if (csv.is_open() && resolved % WINDOW == 0)
+            writeRow();
+        return true;
+    }
+
+    GpuTimings timings() const {
+        GpuTimings result;
+        result.frames = windowFrames;
+        result.resolved = resolved;
+        result.dropped = dropped;
+        for (int pass = 0; pass < GPU_PASS_COUNT && windowFrames > 0; pass++) {
+            result.ms[pass] = sums[pass] / windowFrames;
+            result.totalMs += result.ms[pass];
+        }
+        return result;
+    }
+
+    void writeRow() {
+        GpuTimings average = timings();
+        csv << resolved;
+        for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+            csv << "," << average.ms[pass];
+        csv << "," << average.totalMs << "\n";
+    }
+
+    void destroy() {
+        end();
+        glDeleteQueries(FRAMES * GPU_PASS_COUNT, &queries[0][0]);
+        if (csv.is_open())
+            csv.close();
+    }
+};
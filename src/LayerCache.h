@@ -0,0 +1,251 @@
+#pragma once
+#include "glad.h"
+#include "GLState.h"
+#include "GameConstants.h"
+#include "MeshAtlas.h"
+#include "Renderer.h"
+#include "SpriteBatch.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// Strip memory for every cached layer together; a level needing more draws its layers instanced
+const size_t LAYER_CACHE_MAX_BYTES = 64u << 20;
+
+// One texture of a cached layer, covering [left, right] of layer space at the cache's pixel density
+struct LayerStrip {
+    unsigned int fbo = 0, texture = 0;
+    int width = 0;                      // In pixels, at most GL_MAX_TEXTURE_SIZE
+    float left = 0.0f, right = 0.0f;
+};
+
+// One static parallax layer, rendered into texture strips side by side
+struct CachedLayer {
+    DrawLayer layer;
+    std::vector<LayerStrip> strips;     // Left to right
+    float left = 0.0f, right = 0.0f;    // Layer-space x the layer's instances cover; y always covers -1..1
+    glm::vec4 anim = glm::vec4(0.0f);   // Wave shared by the layer's instances, carried by the composite quads
+    bool empty = true;
+
+    CachedLayer(DrawLayer cachedLayer) : layer(cachedLayer) {}
+};
+
+// Caches the static parallax layers (mountains, trees). Once per level, and
+// again when the framebuffer is resized, each layer's resident instances are
+// rendered into strips as wide as the layer at the framebuffer's pixel
+// density, split wherever a strip would exceed the GPU's texture size; every
+// frame composites each strip as one textured quad, scrolled by the layer's
+// parallax like any instance, so the per-frame cost is flat however much
+// detail the layer has. Layers too long for LAYER_CACHE_MAX_BYTES are left
+// uncached (active false) and drawn instanced instead.
+//
+// A cached layer's instances must be static or share one wave (trees bob
+// with the platforms): the strips are drawn at a zero of that wave and the
+// composite quads apply it.
+struct LayerCache {
+    static const int LAYERS = 2;
+    CachedLayer layers[LAYERS] = {CachedLayer(LAYER_MOUNTAINS), CachedLayer(LAYER_TREES)};
+    const MeshAtlas *atlas = nullptr;
+    InstancedRenderer composite;
+    std::vector<SpriteInstance> quads;  // One composite quad per strip
+    int textureLocation = -1;
+    int framebufferWidth = 0, framebufferHeight = 0;   // Size the strips were rendered for
+    float pixelsPerUnit = 0.0f;
+    int stripHeight = 0;
+    bool valid = false;
+    bool active = false;                // Strips hold the layers; otherwise they are drawn instanced
+    bool reported = false;              // The fallback to instanced layers has been printed
+
+    void init(const MeshAtlas &meshAtlas, unsigned int compositeProgram) {
+        atlas = &meshAtlas;
+        composite.init(meshAtlas, compositeProgram);
+        textureLocation = glGetUniformLocation(compositeProgram, "uLayerTexture");
+    }
+
+    // The level changed; the next prepare() re-renders every strip
+    void invalidate() {
+        valid = false;
+    }
+
+    // Re-render the strips if invalid or the framebuffer changed size, from
+    // the scene's instances as spriteBatch holds them resident. Call after
+    // the level's static upload; restores the frame constants and viewport of
+    // the frame being built. A minimized (zero-sized) framebuffer keeps the
+    // strips as they are.
+    void prepare(SpriteBatch &spriteBatch, const StaticScene &scene, float cameraOffset, float animationTime,
+                 int width, int height) {
+        if (width <= 0 || height <= 0)
+            return;
+        if (valid && width == framebufferWidth && height == framebufferHeight)
+            return;
+        framebufferWidth = width;
+        framebufferHeight = height;
+
+        // Framebuffer pixel density: the view is two units wide
+        GLint maxSize = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+        pixelsPerUnit = width / 2.0f;
+        stripHeight = std::min(height, (int)maxSize);
+
+        size_t bytes = 0;
+        for (CachedLayer &cached : layers) {
+            measure(cached, scene);
+            if (!cached.empty)
+                bytes += (size_t)stripsWidth(cached) * stripHeight * 4;
+        }
+        active = bytes <= LAYER_CACHE_MAX_BYTES;
+        if (!active && !reported) {
+            std::cout << "[layer cache] layers need " << bytes << " bytes of strips, over "
+                      << LAYER_CACHE_MAX_BYTES << "; drawing them instanced" << std::endl;
+            reported = true;
+        }
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        const glm::mat4 projection = spriteBatch.frame.constants.projection;
+
+        for (CachedLayer &cached : layers) {
+            if (!active || cached.empty)
+                release(cached, 0);
+            else if (!render(cached, spriteBatch, scene, (int)maxSize))
+                active = false;
+        }
+        if (!active) {
+            for (CachedLayer &cached : layers)
+                release(cached, 0);
+        }
+
+        glState.bindFramebuffer(0);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        spriteBatch.frame.constants.projection = projection;
+        spriteBatch.frame.update(cameraOffset, animationTime);
+        valid = true;
+    }
+
+    // Layer-space extent of the layer's instances, with a pixel of margin for filtering, and their shared wave
+    void measure(CachedLayer &cached, const StaticScene &scene) {
+        cached.left = FLT_MAX;
+        cached.right = -FLT_MAX;
+        cached.empty = true;
+        for (int mesh = 0; mesh < MESH_COUNT; mesh++) {
+            const MeshRange &range = atlas->range((MeshId)mesh);
+            float meshLeft = FLT_MAX, meshRight = -FLT_MAX;
+            for (uint32_t v = range.firstVertex; v < range.firstVertex + range.vertexCount; v++) {
+                meshLeft = std::min(meshLeft, atlas->vertices[v].x);
+                meshRight = std::max(meshRight, atlas->vertices[v].x);
+            }
+            for (const SpriteInstance &instance : scene.buckets[cached.layer][mesh]) {
+                cached.left = std::min(cached.left, instance.x + meshLeft * instance.width);
+                cached.right = std::max(cached.right, instance.x + meshRight * instance.width);
+                cached.anim = instance.anim;
+                cached.empty = false;
+            }
+        }
+        if (cached.empty)
+            return;
+        cached.left -= 1.0f / pixelsPerUnit;
+        cached.right += 1.0f / pixelsPerUnit;
+    }
+
+    // Pixels across all of a layer's strips
+    int stripsWidth(const CachedLayer &cached) const {
+        return (int)std::ceil((cached.right - cached.left) * pixelsPerUnit);
+    }
+
+    // Delete the strips past the first keep
+    void release(CachedLayer &cached, size_t keep) {
+        for (size_t i = keep; i < cached.strips.size(); i++) {
+            glDeleteFramebuffers(1, &cached.strips[i].fbo);
+            glDeleteTextures(1, &cached.strips[i].texture);
+        }
+        cached.strips.resize(std::min(keep, cached.strips.size()));
+    }
+
+    // Render the layer into as many strips of at most maxSize pixels as it
+    // takes; false if a strip's framebuffer is not usable
+    bool render(CachedLayer &cached, SpriteBatch &spriteBatch, const StaticScene &scene, int maxSize) {
+        InstancedRenderer &instances = spriteBatch.instances;
+        const int totalWidth = stripsWidth(cached);
+        const size_t count = (size_t)((totalWidth + maxSize - 1) / maxSize);
+        release(cached, count);
+        while (cached.strips.size() < count) {
+            LayerStrip strip;
+            glGenFramebuffers(1, &strip.fbo);
+            glGenTextures(1, &strip.texture);
+            cached.strips.push_back(strip);
+        }
+
+        // Draw at a zero crossing of the shared wave; a wave without frequency is baked in
+        float time = 0.0f;
+        if (cached.anim.z != 0.0f)
+            time = -cached.anim.x / cached.anim.z;
+        else
+            cached.anim = glm::vec4(0.0f);
+
+        for (size_t i = 0; i < count; i++) {
+            // Each strip maps its pixels onto the layer at exactly pixelsPerUnit, so neighbours meet seamlessly
+            LayerStrip &strip = cached.strips[i];
+            const int offset = (int)i * maxSize;
+            strip.width = std::min(maxSize, totalWidth - offset);
+            strip.left = cached.left + offset / pixelsPerUnit;
+            strip.right = strip.left + strip.width / pixelsPerUnit;
+
+            glState.bindTexture2D(strip.texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, strip.width, stripHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glState.bindFramebuffer(strip.fbo);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, strip.texture, 0);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                std::cout << "ERROR::LAYER_CACHE::FRAMEBUFFER_INCOMPLETE" << std::endl;
+                return false;
+            }
+            glViewport(0, 0, strip.width, stripHeight);
+            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+
+            // Instances outside the strip are clipped away
+            spriteBatch.frame.constants.projection = glm::ortho(strip.left, strip.right, -1.0f, 1.0f, -1.0f, 1.0f);
+            spriteBatch.frame.update(0.0f, time);
+            for (int mesh = 0; mesh < MESH_COUNT; mesh++)
+                instances.drawStatic(cached.layer, (MeshId)mesh, 0, scene.buckets[cached.layer][mesh].size());
+        }
+        return true;
+    }
+
+    // Composite every strip, back to front; the layers draw before anything else
+    void draw() {
+        if (!active)
+            return;
+        quads.clear();
+        for (const CachedLayer &cached : layers) {
+            for (const LayerStrip &strip : cached.strips)
+                quads.push_back({(strip.left + strip.right) / 2, 0.0f, strip.right - strip.left, 2.0f,
+                                 glm::vec4(1.0f), cached.anim});
+        }
+        composite.beginFrame();
+        composite.upload(quads);
+
+        glState.useProgram(composite.program);
+        glState.uniform1i(textureLocation, 0);
+        size_t quad = 0;
+        for (const CachedLayer &cached : layers) {
+            for (const LayerStrip &strip : cached.strips) {
+                glState.bindTexture2D(strip.texture);
+                composite.drawSlice(cached.layer, MESH_RECT, composite.instanceVBO, quad++, 1);
+            }
+        }
+    }
+
+    void destroy() {
+        composite.destroy();
+        for (CachedLayer &cached : layers)
+            release(cached, 0);
+    }
+};
@@ -0,0 +1,247 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Binary level file, little-endian:
+//
+//   LevelHeader: "PLVL", version, file size, player start, flag position,
+//                then per section its entity count and byte offset
+//   Sections:    one float column after another, each padded to 16 bytes
+//
+// Every section has a fixed set of columns (listed below), so a loaded file
+// is used in place: no parsing, no per-entity records. tools/levelc.cpp
+// compiles the text form into this.
+const uint32_t LEVEL_VERSION = 1;
+const size_t LEVEL_ALIGNMENT = 16;
+
+enum LevelSectionId {
+    LEVEL_PLATFORMS = 0,
+    LEVEL_ENEMIES,
+    LEVEL_COINS,
+    LEVEL_CLOUDS,
+    LEVEL_BIRDS,
+    LEVEL_MOUNTAINS,
+    LEVEL_TREES,
+    LEVEL_SECTION_COUNT
+};
+
+// Columns of each section, in file order
+enum PlatformColumn { PLATFORM_X, PLATFORM_Y, PLATFORM_WIDTH, PLATFORM_HEIGHT, PLATFORM_COLUMNS };
+enum EnemyColumn {
+    ENEMY_X, ENEMY_Y, ENEMY_WIDTH, ENEMY_HEIGHT, ENEMY_VELOCITY, ENEMY_PATROL_LEFT, ENEMY_PATROL_RIGHT,
+    ENEMY_BASE_SCALE, ENEMY_ZOOM_AMOUNT, ENEMY_ZOOM_SPEED, ENEMY_COLUMNS
+};
+enum CoinColumn { COIN_X, COIN_Y, COIN_WIDTH, COIN_HEIGHT, COIN_COLUMNS };
+enum CloudColumn { CLOUD_X, CLOUD_Y, CLOUD_SIZE, CLOUD_COLUMNS };
+enum BirdColumn { BIRD_X, BIRD_Y, BIRD_SPEED, BIRD_COLUMNS };
+enum MountainColumn {
+    MOUNTAIN_X, MOUNTAIN_Y, MOUNTAIN_WIDTH, MOUNTAIN_HEIGHT, MOUNTAIN_R, MOUNTAIN_G, MOUNTAIN_B, MOUNTAIN_A,
+    MOUNTAIN_COLUMNS
+};
+enum TreeColumn { TREE_X, TREE_Y, TREE_SIZE, TREE_COLUMNS };
+
+const int levelSectionColumns[LEVEL_SECTION_COUNT] = {PLATFORM_COLUMNS, ENEMY_COLUMNS, COIN_COLUMNS,
+                                                      CLOUD_COLUMNS, BIRD_COLUMNS, MOUNTAIN_COLUMNS,
+                                                      TREE_COLUMNS};
+const char *const levelSectionNames[LEVEL_SECTION_COUNT] = {"platform", "enemy", "coin", "cloud",
+                                                            "bird", "mountain", "tree"};
+
+struct LevelSection {
+    uint64_t count;     // Entities
+    uint64_t offset;    // Byte offset of the first column, LEVEL_ALIGNMENT aligned
+};
+
+struct LevelHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t fileSize;
+    float playerX, playerY;
+    float flagX, flagY;
+    LevelSection sections[LEVEL_SECTION_COUNT];
+};
+
+// Floats per column in a file: the count rounded up to the alignment
+inline uint64_t levelColumnStride(uint64_t count) {
+    const uint64_t floats = LEVEL_ALIGNMENT / sizeof(float);
+    return (count + floats - 1) / floats * floats;
+}
+
+// One section's columns, wherever they live: column c starts stride floats after column c - 1
+struct LevelColumns {
+    const float *data = nullptr;
+    size_t count = 0;
+    size_t stride = 0;
+
+    const float *operator[](int column) const { return data + column * stride; }
+};
+
+// A level ready to load into a World: a mapped file or a table in the source
+struct LevelView {
+    float playerX = 0.0f, playerY = 0.0f;
+    float flagX = 0.0f, flagY = 0.0f;
+    LevelColumns sections[LEVEL_SECTION_COUNT];
+
+    size_t entities() const {
+        size_t total = 0;
+        for (const LevelColumns &section : sections)
+            total += section.count;
+        return total;
+    }
+};
+
+// A level file mapped read-only into memory. Where mmap is not available the
+// file is read into one buffer instead; either way the view points into it.
+struct LevelFile {
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    std::vector<uint64_t> buffer;   // uint64_t keeps the columns aligned
+#endif
+
+    // Map and validate path; false, with the reason printed, if it is not a usable level
+    bool open(const std::string &path) {
+        close();
+        if (!map(path)) {
+            std::cout << "ERROR::LEVEL::CANNOT_READ " << path << std::endl;
+            return false;
+        }
+        const char *problem = validate();
+        if (problem) {
+            std::cout << "ERROR::LEVEL::" << problem << " " << path << std::endl;
+            close();
+            return false;
+        }
+        return true;
+    }
+
+#ifdef _WIN32
+    bool map(const std::string &path) {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in)
+            return false;
+        size = (size_t)in.tellg();
+        buffer.resize((size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+        in.seekg(0);
+        in.read((char *)buffer.data(), size);
+        data = (const uint8_t *)buffer.data();
+        return (bool)in;
+    }
+
+    void close() {
+        buffer.clear();
+        buffer.shrink_to_fit();
+        data = nullptr;
+        size = 0;
+    }
+#else
+    bool map(const std::string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        void *mapped = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && info.st_size > 0)
+            mapped = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);    // The mapping stays valid without the descriptor
+        if (mapped == MAP_FAILED)
+            return false;
+        data = (const uint8_t *)mapped;
+        size = (size_t)info.st_size;
+        return true;
+    }
+
+    void close() {
+        if (data)
+            munmap((void *)data, size);
+        data = nullptr;
+        size = 0;
+    }
+#endif
+
+    const LevelHeader &header() const {
+        return *(const LevelHeader *)data;
+    }
+
+    // Why the mapped bytes are not a level this build reads, or null. A
+    // big-endian host fails here too: its version reads byte-swapped.
+    const char *validate() const {
+        if (size < sizeof(LevelHeader) || std::memcmp(header().magic, "PLVL", 4) != 0)
+            return "NOT_A_LEVEL";
+        if (header().version != LEVEL_VERSION)
+            return "UNSUPPORTED_VERSION";
+        if (header().fileSize != size)
+            return "TRUNCATED";
+        for (int s = 0; s < LEVEL_SECTION_COUNT; s++) {
+            const LevelSection &section = header().sections[s];
+            if (section.offset % LEVEL_ALIGNMENT != 0 || section.count > size / sizeof(float))
+                return "BAD_SECTION";
+            uint64_t bytes = levelColumnStride(section.count) * levelSectionColumns[s] * sizeof(float);
+            if (section.offset > size || bytes > size - section.offset)
+                return "BAD_SECTION";
+        }
+        return nullptr;
+    }
+
+    LevelView view() const {
+        LevelView level;
+        const LevelHeader &h = header();
+        level.playerX = h.playerX;
+        level.playerY = h.playerY;
+        level.flagX = h.flagX;
+        level.flagY = h.flagY;
+        for (int s = 0; s < LEVEL_SECTION_COUNT; s++) {
+            level.sections[s].data = (const float *)(data + h.sections[s].offset);
+            level.sections[s].count = (size_t)h.sections[s].count;
+            level.sections[s].stride = (size_t)levelColumnStride(h.sections[s].count);
+        }
+        return level;
+    }
+};
+
+// Write a level in the binary format; sections are laid out in order after the header
+bool writeLevel(const std::string &path, const LevelView &level)
+{
+    LevelHeader header = {};
+    std::memcpy(header.magic, "PLVL", 4);
+    header.version = LEVEL_VERSION;
+    header.playerX = level.playerX;
+    header.playerY = level.playerY;
+    header.flagX = level.flagX;
+    header.flagY = level.flagY;
+    uint64_t offset = (sizeof(LevelHeader) + LEVEL_ALIGNMENT - 1) / LEVEL_ALIGNMENT * LEVEL_ALIGNMENT;
+    for (int s = 0; s < LEVEL_SECTION_COUNT; s++) {
+        header.sections[s].count = level.sections[s].count;
+        header.sections[s].offset = offset;
+        offset += levelColumnStride(level.sections[s].count) * levelSectionColumns[s] * sizeof(float);
+    }
+    header.fileSize = offset;
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cout << "ERROR::LEVEL::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+    std::vector<char> padding(LEVEL_ALIGNMENT, 0);
+    out.write((const char *)&header, sizeof(header));
+    out.write(padding.data(), header.sections[0].offset - sizeof(header));
+    for (int s = 0; s < LEVEL_SECTION_COUNT; s++) {
+        const LevelColumns &section = level.sections[s];
+        size_t pad = (levelColumnStride(section.count) - section.count) * sizeof(float);
+        for (int column = 0; column < levelSectionColumns[s]; column++) {
+            out.write((const char *)section[column], section.count * sizeof(float));
+            out.write(padding.data(), pad);
+        }
+    }
+    return (bool)out;
+}
@@ -0,0 +1,311 @@
+#pragma once
+#include "GameConstants.h"
+#include "GameObjects.h"
+#include "EntityStore.h"
+#include "LevelFormat.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Endless levels are cut into chunks CHUNK_WIDTH wide; chunk k covers world
+// x from CHUNK_ORIGIN + k * CHUNK_WIDTH. Chunk 0 holds the start platform.
+const float CHUNK_WIDTH = 3.0f;
+const float CHUNK_ORIGIN = -1.5f;
+
+// Index of a pooled chunk holding nothing; chunks behind the start have negative indices
+const long long NO_CHUNK = std::numeric_limits<long long>::min();
+
+// Entities a chunk can hold, by level section; generation never exceeds these
+const int chunkCapacity[LEVEL_SECTION_COUNT] = {16, 16, 32, 4, 0, 2, 4};
+
+inline long long chunkIndex(float x) {
+    float k = (x - CHUNK_ORIGIN) / CHUNK_WIDTH;
+    long long truncated = (long long)k;
+    return truncated - (k < (float)truncated);
+}
+
+// One generated chunk: its sections in level columns, each at a stride of the
+// section's capacity, plus the state the simulation writes back while the
+// chunk is resident. Storage is sized once, so recycling allocates nothing.
+struct LevelChunk {
+    long long index = NO_CHUNK;
+    bool ready = false;             // Generated; only the simulation touches it now
+    std::vector<float> columns[LEVEL_SECTION_COUNT];
+    size_t counts[LEVEL_SECTION_COUNT] = {};
+    std::vector<float> cloudPhase;  // Cloud bounce phase, one per cloud
+    BitSet collected;               // Coins taken while resident
+    double generateMs = 0.0;
+
+    void allocate() {
+        for (int s = 0; s < LEVEL_SECTION_COUNT; s++)
+            columns[s].assign((size_t)chunkCapacity[s] * levelSectionColumns[s], 0.0f);
+        cloudPhase.assign(chunkCapacity[LEVEL_CLOUDS], 0.0f);
+        collected.reset(chunkCapacity[LEVEL_COINS]);
+    }
+
+    void clear() {
+        std::fill(counts, counts + LEVEL_SECTION_COUNT, 0);
+        collected.reset(chunkCapacity[LEVEL_COINS]);
+    }
+
+    LevelColumns section(int s) const {
+        return {columns[s].data(), counts[s], (size_t)chunkCapacity[s]};
+    }
+
+    float *column(int s, int c) {
+        return columns[s].data() + (size_t)c * chunkCapacity[s];
+    }
+
+    // Append one entity's values in column order; false when the section is full
+    bool add(int s, std::initializer_list<float> values) {
+        if (counts[s] >= (size_t)chunkCapacity[s])
+            return false;
+        int c = 0;
+        for (float value : values)
+            column(s, c++)[counts[s]] = value;
+        counts[s]++;
+        return true;
+    }
+};
+
+// Per-chunk generator seed: the same seed and index always give the same chunk
+inline uint32_t chunkSeed(uint32_t seed, long long index) {
+    uint64_t h = (uint64_t)index * 0x9E3779B97F4A7C15ull ^ seed;
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 29;
+    return (uint32_t)h | 1;
+}
+
+inline float randomRange(Rng &rng, float low, float high) {
+    return low + rng.next01() * (high - low);
+}
+
+// Fill chunk with chunk index's entities. Platforms run the chunk's width
+// with jumpable gaps, starting and ending at the rest height and 0.1 in from
+// the edges, so neighbouring chunks always join. Background layers get the
+// slice of their own space that the chunk's span scrolls past.
+void generateChunk(LevelChunk &chunk, long long index, uint32_t seed)
+{
+    chunk.clear();
+    Rng rng(chunkSeed(seed, index));
+    const float left = CHUNK_ORIGIN + (float)index * CHUNK_WIDTH;
+    const float right = left + CHUNK_WIDTH;
+
+    float mountainX = randomRange(rng, left, right) * MOUNTAIN_PARALLAX;
+    float green = randomRange(rng, 0.4f, 0.55f);
+    chunk.add(LEVEL_MOUNTAINS, {mountainX, -0.55f, randomRange(rng, 0.7f, 1.0f), randomRange(rng, 0.35f, 0.5f),
+                                green - 0.2f, green, green - 0.2f, 1.0f});
+    for (int t = 0; t < 2; t++)
+    {
+        float slot = left + CHUNK_WIDTH * (t + randomRange(rng, 0.1f, 0.9f)) / 2;
+        chunk.add(LEVEL_TREES, {slot * TREE_PARALLAX, -0.4f, randomRange(rng, 0.2f, 0.25f)});
+    }
+    for (int c = 0; c < 2; c++)
+    {
+        chunk.cloudPhase[chunk.counts[LEVEL_CLOUDS]] = rng.next01() * 6.28f;
+        chunk.add(LEVEL_CLOUDS, {randomRange(rng, left, right), randomRange(rng, 0.55f, 0.85f), 0.1f});
+    }
+    if (index < 0)
+        return;     // Nothing to stand on behind the start
+
+    const float restY = -0.5f;
+    float x = left + randomRange(rng, 0.05f, 0.15f);
+    float y = restY;
+    bool first = true;
+    for (;;)
+    {
+        float width = randomRange(rng, 0.3f, 0.6f);
+        if (index == 0 && first)
+        {
+            x = -1.2f;      // Under the player's start
+            width = 0.8f;
+        }
+        float remaining = right - 0.1f - x;
+        bool last = remaining - width < 0.6f;
+        if (last)
+            width = remaining;
+        y = (first || last) ? restY : std::min(-0.35f, std::max(-0.6f, y + randomRange(rng, -0.1f, 0.1f)));
+        float center = x + width / 2;
+        chunk.add(LEVEL_PLATFORMS, {center, y, width, 0.1f});
+
+        bool start = index == 0 && first;
+        if (!start && width >= 0.45f && rng.next01() < 0.35f)
+            chunk.add(LEVEL_ENEMIES, {center, y + 0.1f, 0.08f, 0.08f, 0.2f, x + 0.09f, x + width - 0.09f,
+                                      1.0f, 0.2f, 2.0f});
+        else if (!start && rng.next01() < 0.3f)
+            chunk.add(LEVEL_COINS, {center, y + 0.3f, 0.05f, 0.05f});
+        if (last)
+            break;
+
+        float gap = randomRange(rng, 0.1f, 0.3f);
+        if (rng.next01() < 0.5f)
+            chunk.add(LEVEL_COINS, {x + width + gap / 2, y + 0.3f, 0.05f, 0.05f});
+        x += width + gap;
+        first = false;
+    }
+}
+
+// Streaming counters, cumulative since start()
+struct StreamStats {
+    long long generated = 0;
+    double generateMs = 0.0;        // Worker time spent generating
+    double maxGenerateMs = 0.0;
+    long long moves = 0;            // Times the resident window moved
+    long long stalls = 0;           // Chunks the simulation had to wait for
+    int resident = 0;
+    int free = 0;                   // Pooled chunks holding nothing
+};
+
+// Keeps a fixed pool of chunks filled around a window that the simulation
+// moves as the camera advances. A worker thread generates every chunk of
+// [first, first + POOL) not already held, nearest first; chunks that fall
+// out of the window go back to the pool. Pool size, and so memory, is fixed
+// however far the player runs.
+//
+// The simulation uses [first, first + RESIDENT); the rest is generated ahead
+// so a move rarely has to wait. Chunks depend only on the seed and their
+// index, so when they are generated never changes what the simulation sees.
+struct LevelStream {
+    static const int RESIDENT = 5;
+    static const int AHEAD = 2;
+    static const int POOL = RESIDENT + AHEAD;
+
+    LevelChunk chunks[POOL];
+    LevelChunk *resident[RESIDENT] = {};   // Set by acquireWindow(), in index order
+    long long first = 0;
+    bool placed = false;                    // first has been set; the worker waits until then
+    bool active = false;                    // A window has been acquired
+    uint32_t seed = 1;
+    StreamStats stats;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;           // Worker: the window moved, or stop
+    std::condition_variable generated;      // Simulation: a chunk became ready
+    bool stopping = false;
+
+    void start() {
+        for (LevelChunk &chunk : chunks)
+            chunk.allocate();
+        stopping = false;
+        worker = std::thread(&LevelStream::generateLoop, this);
+    }
+
+    void stop() {
+        if (!worker.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        worker.join();
+    }
+
+    ~LevelStream() {
+        stop();
+    }
+
+    // Make [windowFirst, windowFirst + RESIDENT) resident, waiting for any
+    // chunk not generated yet. fresh drops every held chunk first and
+    // generates from worldSeed, so the window comes back exactly as
+    // generated (a restart).
+    void acquireWindow(long long windowFirst, bool fresh, uint32_t worldSeed) {
+        std::unique_lock<std::mutex> lock(mutex);
+        first = windowFirst;
+        placed = true;
+        if (fresh)
+            seed = worldSeed;
+        for (LevelChunk &chunk : chunks) {
+            if (chunk.ready && (fresh || chunk.index < first || chunk.index >= first + POOL)) {
+                chunk.index = NO_CHUNK;
+                chunk.ready = false;
+            }
+        }
+        wake.notify_all();
+        for (int r = 0; r < RESIDENT; r++) {
+            LevelChunk *found = nullptr;
+            bool waited = false;
+            while (!(found = held(first + r, true))) {
+                waited = true;
+                generated.wait(lock);
+            }
+            if (waited && active && !fresh)
+                stats.stalls++;
+            resident[r] = found;
+        }
+        if (active && !fresh)
+            stats.moves++;
+        active = true;
+        stats.resident = RESIDENT;
+    }
+
+    // Chunk holding index, optionally only once generated; call with the mutex held
+    LevelChunk *held(long long index, bool ready) {
+        for (LevelChunk &chunk : chunks)
+            if (chunk.index == index && (chunk.ready || !ready))
+                return &chunk;
+        return nullptr;
+    }
+
+    void generateLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            LevelChunk *chunk = nullptr;
+            long long index = 0;
+            while (!stopping && !(chunk = claim(index)))
+                wake.wait(lock);
+            if (stopping)
+                return;
+            const uint32_t chunkSeed = seed;
+
+            lock.unlock();
+            auto start = std::chrono::steady_clock::now();
+            generateChunk(*chunk, index, chunkSeed);
+            chunk->generateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            lock.lock();
+
+            stats.generated++;
+            stats.generateMs += chunk->generateMs;
+            stats.maxGenerateMs = std::max(stats.maxGenerateMs, chunk->generateMs);
+            if (index < first || index >= first + POOL || chunkSeed != seed)
+                chunk->index = NO_CHUNK;      // The window moved on, or restarted with another seed, meanwhile
+            else
+                chunk->ready = true;
+            generated.notify_all();
+        }
+    }
+
+    // A free chunk for the first index of the window not yet held; call with the mutex held
+    LevelChunk *claim(long long &index) {
+        LevelChunk *freeChunk = nullptr;
+        for (LevelChunk &chunk : chunks)
+            if (chunk.index == NO_CHUNK)
+                freeChunk = &chunk;
+        if (!freeChunk || !placed)
+            return nullptr;
+        for (index = first; index < first + POOL; index++) {
+            if (!held(index, false)) {
+                freeChunk->index = index;
+                freeChunk->ready = false;
+                return freeChunk;
+            }
+        }
+        return nullptr;
+    }
+
+    StreamStats snapshot() {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.free = 0;
+        for (const LevelChunk &chunk : chunks)
+            stats.free += chunk.index == NO_CHUNK;
+        return stats;
+    }
+};
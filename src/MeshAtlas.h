@@ -0,0 +1,143 @@
+#pragma once
+#include "glad.h"
+#include "GLState.h"
+#include "Utils.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// Unit meshes packed into the atlas, in per-layer draw order
+enum MeshId {
+    MESH_RECT = 0,      // -0.5..0.5 quad
+    MESH_CIRCLE,        // 32-segment disc of radius 1
+    MESH_TRIANGLE,      // Birds, mountains, tree crowns, sun rays
+    MESH_DIAMOND,       // Coins
+    MESH_PENNANT,       // Flag, pointing left from the pole
+    // Quads for the SDF program, which shades the shape analytically; each
+    // quad covers its shape plus an antialiasing margin, in shape units
+    MESH_SDF_CIRCLE,    // Disc of radius 1
+    MESH_SDF_CLOUD,     // Four overlapping discs, in units of the cloud's size
+    MESH_SDF_RAYS,      // The sun's eight turning rays, in world units around the sun's center
+    MESH_COUNT
+};
+
+inline bool isSdfMesh(MeshId mesh) {
+    return mesh >= MESH_SDF_CIRCLE;
+}
+
+// Index of an SDF mesh's shape in sdfFragmentShaderSource (uShape)
+inline int sdfShape(MeshId mesh) {
+    return (int)mesh - MESH_SDF_CIRCLE;
+}
+
+// Named sub-range of the atlas buffers. Indices are absolute, so a draw
+// only needs firstIndex/indexCount.
+struct MeshRange {
+    const char *name;
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+// Every unit mesh in one immutable vertex/index buffer pair, with a CPU copy
+// for paths that expand geometry themselves
+struct MeshAtlas {
+    std::vector<glm::vec2> vertices;
+    std::vector<uint32_t> indices;
+    MeshRange ranges[MESH_COUNT];
+    unsigned int vbo = 0, ebo = 0;
+
+    // Build the CPU copy and upload it once; the buffers are never written again
+    void init() {
+        build();
+        glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ebo);
+        glState.bindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec2), vertices.data(), GL_STATIC_DRAW);
+        glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+    }
+
+    const MeshRange &range(MeshId mesh) const {
+        return ranges[mesh];
+    }
+
+    // Indices must be pushed right after the mesh's vertices, relative to its first vertex
+    void beginMesh(MeshId mesh, const char *name) {
+        ranges[mesh] = {name, (uint32_t)vertices.size(), 0, (uint32_t)indices.size(), 0};
+    }
+
+    void endMesh(MeshId mesh, const std::vector<uint32_t> &localIndices) {
+        MeshRange &r = ranges[mesh];
+        r.vertexCount = (uint32_t)vertices.size() - r.firstVertex;
+        for (uint32_t index : localIndices)
+            indices.push_back(r.firstVertex + index);
+        r.indexCount = (uint32_t)indices.size() - r.firstIndex;
+    }
+
+    void build() {
+        vertices.clear();
+        indices.clear();
+
+        beginMesh(MESH_RECT, "rect");
+        vertices.push_back(glm::vec2(-0.5f, -0.5f));
+        vertices.push_back(glm::vec2(0.5f, -0.5f));
+        vertices.push_back(glm::vec2(0.5f, 0.5f));
+        vertices.push_back(glm::vec2(-0.5f, 0.5f));
+        endMesh(MESH_RECT, {0, 1, 2, 0, 2, 3});
+
+        // Circle fan (center + closed perimeter) turned into a triangle list
+        const int circleSegments = 32;
+        float circleVertices[(circleSegments + 2) * 3];
+        drawCircleVertices(circleVertices, circleSegments, 1.0f);
+        beginMesh(MESH_CIRCLE, "circle");
+        for (int i = 0; i < circleSegments + 2; i++)
+            vertices.push_back(glm::vec2(circleVertices[i * 3], circleVertices[i * 3 + 1]));
+        std::vector<uint32_t> fan;
+        for (uint32_t i = 1; i <= circleSegments; i++) {
+            fan.push_back(0);
+            fan.push_back(i);
+            fan.push_back(i + 1);
+        }
+        endMesh(MESH_CIRCLE, fan);
+
+        beginMesh(MESH_TRIANGLE, "triangle");
+        for (int i = 0; i < 3; i++)
+            vertices.push_back(glm::vec2(triangleVertices[i * 3], triangleVertices[i * 3 + 1]));
+        endMesh(MESH_TRIANGLE, {0, 1, 2});
+
+        // Diamond: top, right, bottom, left
+        beginMesh(MESH_DIAMOND, "diamond");
+        vertices.push_back(glm::vec2(0.0f, 1.0f));
+        vertices.push_back(glm::vec2(1.0f, 0.0f));
+        vertices.push_back(glm::vec2(0.0f, -1.0f));
+        vertices.push_back(glm::vec2(-1.0f, 0.0f));
+        endMesh(MESH_DIAMOND, {0, 1, 2, 0, 2, 3});
+
+        beginMesh(MESH_PENNANT, "pennant");
+        vertices.push_back(glm::vec2(0.0f, 0.5f));
+        vertices.push_back(glm::vec2(0.0f, -0.5f));
+        vertices.push_back(glm::vec2(-1.0f, 0.0f));
+        endMesh(MESH_PENNANT, {0, 1, 2});
+
+        sdfQuad(MESH_SDF_CIRCLE, "sdf circle", 1.1f, 1.1f);
+        sdfQuad(MESH_SDF_CLOUD, "sdf cloud", 1.9f, 1.1f);
+        sdfQuad(MESH_SDF_RAYS, "sdf rays", 0.24f, 0.24f);
+    }
+
+    // Quad spanning [-halfWidth, halfWidth] x [-halfHeight, halfHeight]
+    void sdfQuad(MeshId mesh, const char *name, float halfWidth, float halfHeight) {
+        beginMesh(mesh, name);
+        vertices.push_back(glm::vec2(-halfWidth, -halfHeight));
+        vertices.push_back(glm::vec2(halfWidth, -halfHeight));
+        vertices.push_back(glm::vec2(halfWidth, halfHeight));
+        vertices.push_back(glm::vec2(-halfWidth, halfHeight));
+        endMesh(mesh, {0, 1, 2, 0, 2, 3});
+    }
+
+    void destroy() {
+        glDeleteBuffers(1, &vbo);
+        glDeleteBuffers(1, &ebo);
+    }
+};
@@ -0,0 +1,293 @@
+#pragma once
+#include "GameObjects.h"
+#include "MeshAtlas.h"
+#include "Renderer.h"
+#include "Utils.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// Programs a batch can be drawn with; within a layer, resident static
+// instances go first, then the frame's instances, then streamed triangles
+enum SpriteShader {
+    SPRITE_SHADER_STATIC = 0,       // InstancedRenderer's resident level buffer
+    SPRITE_SHADER_INSTANCED,        // InstancedRenderer, one draw per atlas mesh
+    SPRITE_SHADER_SDF_STATIC,       // Resident SDF shapes
+    SPRITE_SHADER_SDF,              // SDF shapes: one antialiased quad each
+    SPRITE_SHADER_STREAM,           // Pre-transformed triangles from the stream buffer
+};
+
+// Sort key of a draw: layer, shader and mesh in the high bytes, so sorting
+// groups everything one draw call can take; submission order in the low
+// 40 bits keeps overlapping shapes of one group in the order they were queued
+inline uint64_t renderKey(DrawLayer layer, SpriteShader shader, MeshId mesh, uint64_t sequence) {
+    return ((uint64_t)layer << 56) | ((uint64_t)shader << 48) | ((uint64_t)mesh << 40) |
+           (sequence & 0xffffffffffull);
+}
+
+inline DrawLayer keyLayer(uint64_t key) { return (DrawLayer)(key >> 56); }
+inline SpriteShader keyShader(uint64_t key) { return (SpriteShader)((key >> 48) & 0xff); }
+inline MeshId keyMesh(uint64_t key) { return (MeshId)((key >> 40) & 0xff); }
+
+// One queued draw intent
+struct RenderCommand {
+    uint64_t key;
+    uint32_t payload;   // Index into the queue's instances or shapes; first instance of a static slice
+    uint32_t count;     // Static slices only
+};
+
+// Atlas mesh placed by the 2D part of a Matrix4, for the stream path
+struct StreamShape {
+    float m0, m1, m4, m5, tx, ty;
+    glm::vec4 color;
+};
+
+// One vertex of the streaming buffer
+struct SpriteVertex {
+    glm::vec2 position;
+    glm::vec4 color;
+};
+
+// One draw call of the built frame. first/count index the queue's sorted
+// instances (instanced shaders), the StaticScene bucket (static shaders)
+// or the stream indices.
+struct RenderBatch {
+    DrawLayer layer;
+    SpriteShader shader;
+    MeshId mesh;
+    size_t first;
+    size_t count;
+};
+
+// Stable LSD radix sort of commands by key, one byte per pass. All eight
+// byte histograms come from one read of the keys; passes whose byte is the
+// same in every key (most of the high bytes, usually) are skipped. Short
+// lists, where the passes cost more than comparing, use std::stable_sort.
+const size_t RADIX_SORT_MIN_COMMANDS = 1024;
+
+void radixSortCommands(std::vector<RenderCommand> &commands, std::vector<RenderCommand> &scratch)
+{
+    if (commands.size() < RADIX_SORT_MIN_COMMANDS) {
+        std::stable_sort(commands.begin(), commands.end(),
+                         [](const RenderCommand &a, const RenderCommand &b) { return a.key < b.key; });
+        return;
+    }
+    uint32_t counts[8][256] = {};
+    for (const RenderCommand &cmd : commands) {
+        for (int b = 0; b < 8; b++)
+            counts[b][(cmd.key >> (b * 8)) & 0xff]++;
+    }
+    scratch.resize(commands.size());
+    for (int b = 0; b < 8; b++) {
+        const int shift = b * 8;
+        if (counts[b][(commands[0].key >> shift) & 0xff] == commands.size())
+            continue;
+        uint32_t offset = 0;
+        for (uint32_t &count : counts[b]) {
+            uint32_t n = count;
+            count = offset;
+            offset += n;
+        }
+        for (const RenderCommand &cmd : commands)
+            scratch[counts[b][(cmd.key >> shift) & 0xff]++] = cmd;
+        commands.swap(scratch);
+    }
+}
+
+// A frame's draws as data: the front end (shape, quad, circle, showStatic,
+// draw) queues commands without touching GL, build() sorts them and merges
+// runs into batches, and a backend (SpriteBatch, SoftwareRasterizer)
+// executes the batches. A queue is a plain value, so a built frame can be
+// kept and executed again.
+//
+// Shapes that are only translated and scaled become instances of an atlas
+// mesh; circles and clouds are SDF quads shaded analytically; arbitrary
+// transforms (rotation) are expanded on the CPU into stream triangles.
+// Positions are in world space: backends apply the camera, parallax and
+// animation time of the frame.
+struct RenderQueue {
+    std::vector<RenderCommand> commands;
+    std::vector<SpriteInstance> instances;  // Payloads, in submission order
+    std::vector<StreamShape> shapes;
+    uint64_t sequence = 0;
+    int intents = 0;            // Shapes queued this frame
+    int staticInstances = 0;    // Resident instances shown this frame
+
+    // Built by build()
+    std::vector<RenderBatch> batches;
+    std::vector<SpriteInstance> sortedInstances;
+    std::vector<SpriteVertex> streamVertices;
+    std::vector<uint32_t> streamIndices;
+    std::vector<RenderCommand> scratch;
+
+    void clear() {
+        commands.clear();
+        instances.clear();
+        shapes.clear();
+        sequence = 0;
+        intents = 0;
+        staticInstances = 0;
+    }
+
+    // Atlas mesh translated to (x, y) and scaled, optionally animated by the
+    // backend (see spriteAnim). MESH_SDF_* meshes are shaded as SDFs, scaled
+    // from their shape units.
+    void shape(DrawLayer layer, MeshId mesh, float x, float y, float scaleX, float scaleY,
+               const glm::vec4 &color, const glm::vec4 &anim = glm::vec4(0.0f)) {
+        SpriteShader shader = isSdfMesh(mesh) ? SPRITE_SHADER_SDF : SPRITE_SHADER_INSTANCED;
+        submit(layer, shader, mesh, {x, y, scaleX, scaleY, color, anim});
+    }
+
+    // Axis-aligned rect centered on (x, y)
+    void quad(DrawLayer layer, float x, float y, float width, float height,
+              const glm::vec4 &color, const glm::vec4 &anim = glm::vec4(0.0f)) {
+        shape(layer, MESH_RECT, x, y, width, height, color, anim);
+    }
+
+    void circle(DrawLayer layer, float x, float y, float radius,
+                const glm::vec4 &color, const glm::vec4 &anim = glm::vec4(0.0f)) {
+        shape(layer, MESH_SDF_CIRCLE, x, y, radius, radius, color, anim);
+    }
+
+    // Instances [first, first + count) of a StaticScene bucket
+    void showStatic(DrawLayer layer, MeshId mesh, size_t first, size_t count) {
+        SpriteShader shader = isSdfMesh(mesh) ? SPRITE_SHADER_SDF_STATIC : SPRITE_SHADER_STATIC;
+        submitStatic(layer, shader, mesh, first, count);
+    }
+
+    // Atlas mesh under an arbitrary Matrix4, expanded into stream triangles
+    void draw(DrawLayer layer, MeshId mesh, const Matrix4 &transform, const glm::vec4 &color) {
+        submitStream(layer, mesh, transform, color);
+    }
+
+    void submit(DrawLayer layer, SpriteShader shader, MeshId mesh, const SpriteInstance &instance) {
+        commands.push_back({renderKey(layer, shader, mesh, sequence++), (uint32_t)instances.size(), 0});
+        instances.push_back(instance);
+        intents++;
+    }
+
+    void submitStatic(DrawLayer layer, SpriteShader shader, MeshId mesh, size_t first, size_t count) {
+        if (count > 0)
+            commands.push_back({renderKey(layer, shader, mesh, sequence++), (uint32_t)first, (uint32_t)count});
+        staticInstances += (int)count;
+    }
+
+    void submitStream(DrawLayer layer, MeshId mesh, const Matrix4 &transform, const glm::vec4 &color) {
+        commands.push_back({renderKey(layer, SPRITE_SHADER_STREAM, mesh, sequence++), (uint32_t)shapes.size(), 0});
+        shapes.push_back({transform.m[0], transform.m[1], transform.m[4], transform.m[5],
+                          transform.m[12], transform.m[13], color});
+        intents++;
+    }
+
+    // Sort the commands and merge them into batches: one per (layer, shader,
+    // mesh) run of instances, one per contiguous static slice and one per
+    // layer of stream shapes, which are expanded here on the CPU
+    void build(const MeshAtlas &atlas) {
+        radixSortCommands(commands, scratch);
+        batches.clear();
+        sortedInstances.clear();
+        streamVertices.clear();
+        streamIndices.clear();
+
+        for (const RenderCommand &cmd : commands) {
+            DrawLayer layer = keyLayer(cmd.key);
+            SpriteShader shader = keyShader(cmd.key);
+            MeshId mesh = keyMesh(cmd.key);
+            RenderBatch *last = batches.empty() ? nullptr : &batches.back();
+            bool sameGroup = last && last->layer == layer && last->shader == shader && last->mesh == mesh;
+
+            if (shader == SPRITE_SHADER_STATIC || shader == SPRITE_SHADER_SDF_STATIC) {
+                if (sameGroup && last->first + last->count == cmd.payload)
+                    last->count += cmd.count;
+                else
+                    batches.push_back({layer, shader, mesh, cmd.payload, cmd.count});
+            } else if (shader == SPRITE_SHADER_STREAM) {
+                if (!(last && last->layer == layer && last->shader == shader))
+                    batches.push_back({layer, shader, MESH_COUNT, streamIndices.size(), 0});
+                expand(atlas, mesh, shapes[cmd.payload]);
+                batches.back().count = streamIndices.size() - batches.back().first;
+            } else {
+                if (!sameGroup)
+                    batches.push_back({layer, shader, mesh, sortedInstances.size(), 0});
+                sortedInstances.push_back(instances[cmd.payload]);
+                batches.back().count++;
+            }
+        }
+    }
+
+    void expand(const MeshAtlas &atlas, MeshId mesh, const StreamShape &shape) {
+        const MeshRange &range = atlas.range(mesh);
+        uint32_t base = (uint32_t)streamVertices.size();
+        for (uint32_t i = 0; i < range.vertexCount; i++) {
+            const glm::vec2 &v = atlas.vertices[range.firstVertex + i];
+            glm::vec2 p(shape.m0 * v.x + shape.m4 * v.y + shape.tx,
+                        shape.m1 * v.x + shape.m5 * v.y + shape.ty);
+            streamVertices.push_back({p, shape.color});
+        }
+        for (uint32_t i = 0; i < range.indexCount; i++)
+            streamIndices.push_back(base + atlas.indices[range.firstIndex + i] - range.firstVertex);
+    }
+};
+
+// Record one synthetic frame of count draws in random layers and meshes
+// (a few percent streamed), then replay its build repeatedly without a GL
+// context, and time radixSortCommands against std::stable_sort on the same keys
+void runRenderQueueBenchmark(size_t count)
+{
+    MeshAtlas atlas;
+    atlas.build();
+    Rng rng(12345);
+    RenderQueue recorded;
+    for (size_t i = 0; i < count; i++) {
+        DrawLayer layer = (DrawLayer)(rng.next() % LAYER_COUNT);
+        MeshId mesh = (MeshId)(rng.next() % MESH_COUNT);
+        glm::vec4 color(rng.next01(), rng.next01(), rng.next01(), 1.0f);
+        if (rng.next() % 32 == 0 && !isSdfMesh(mesh)) {
+            Matrix4 transform;
+            transform.rotate(rng.next01() * 6.28f);
+            recorded.submitStream(layer, mesh, transform, color);
+        } else {
+            SpriteShader shader = isSdfMesh(mesh) ? SPRITE_SHADER_SDF : SPRITE_SHADER_INSTANCED;
+            recorded.submit(layer, shader, mesh, {rng.next01(), rng.next01(), 0.1f, 0.1f, color, glm::vec4(0.0f)});
+        }
+    }
+
+    const int passes = (int)(20000000 / (count + 1)) + 1;
+    RenderQueue replay = recorded;
+    std::vector<RenderCommand> sorted;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++) {
+        replay.commands = recorded.commands;
+        radixSortCommands(replay.commands, replay.scratch);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++) {
+        sorted = recorded.commands;
+        std::stable_sort(sorted.begin(), sorted.end(),
+                         [](const RenderCommand &a, const RenderCommand &b) { return a.key < b.key; });
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++) {
+        replay.commands = recorded.commands;
+        replay.build(atlas);
+    }
+    auto t3 = std::chrono::steady_clock::now();
+
+    // build() left replay.commands radix-sorted
+    bool match = true;
+    for (size_t i = 0; i < sorted.size() && match; i++)
+        match = sorted[i].key == replay.commands[i].key && sorted[i].payload == replay.commands[i].payload;
+    double radixNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / ((double)passes * count);
+    double stableNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / ((double)passes * count);
+    double buildUs = std::chrono::duration<double, std::micro>(t3 - t2).count() / passes;
+    std::cout << "queue: " << count << " draws x " << passes << " passes, "
+              << replay.batches.size() << " batches\n"
+              << "queue: radixSortCommands " << radixNs << " ns/draw, std::stable_sort " << stableNs << " ns/draw, "
+              << (radixNs > 0.0 ? stableNs / radixNs : 0.0) << "x\n"
+              << "queue: build " << buildUs << " us/frame\n"
+              << "queue: orders " << (match ? "match" : "DIFFER") << std::endl;
+}
@@ -0,0 +1,324 @@
+#pragma once
+#include "glad.h"
+#include "GLState.h"
+#include "GameConstants.h"
+#include "MeshAtlas.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+// Compile and link a vertex/fragment shader pair, printing any errors
+unsigned int createShaderProgram(const char *vertexSource, const char *fragmentSource)
+{
+    int success;
+    char infoLog[512];
+
+    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShader, 1, &vertexSource, NULL);
+    glCompileShader(vertexShader);
+    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n"
+                  << infoLog << std::endl;
+    }
+
+    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
+    glCompileShader(fragmentShader);
+    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n"
+                  << infoLog << std::endl;
+    }
+
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n"
+                  << infoLog << std::endl;
+    }
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    return program;
+}
+
+// Draw layers, back to front
+enum DrawLayer {
+    LAYER_MOUNTAINS = 0,
+    LAYER_TREES,
+    LAYER_SUN,
+    LAYER_CLOUDS,
+    LAYER_BIRDS,
+    LAYER_WORLD,            // Platforms and enemies
+    LAYER_COINS,
+    LAYER_FLAG,
+    LAYER_PLAYER,
+    LAYER_COUNT
+};
+
+// Horizontal camera factor of each layer: 0 = fixed to the screen, 1 = moves with the world
+const float layerParallax[LAYER_COUNT] = {
+    MOUNTAIN_PARALLAX,
+    TREE_PARALLAX,
+    0.0f,   // Sun
+    1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+};
+
+// Binding point of the FrameConstants uniform block in every program
+const unsigned int FRAME_CONSTANTS_BINDING = 0;
+
+// CPU mirror of the std140 FrameConstants block in Shaders.h
+struct FrameConstants {
+    glm::mat4 projection;
+    glm::vec4 cameraTime;       // x = camera offset, y = animation time
+    glm::vec4 parallax[3];      // layerParallax, four layers per vec4
+};
+static_assert(sizeof(FrameConstants) == 128, "FrameConstants must match the std140 block layout");
+
+// The per-frame constants every program reads: written once per frame and
+// bound once to FRAME_CONSTANTS_BINDING, instead of per-draw uniforms
+struct FrameUniformBuffer {
+    unsigned int ubo = 0;
+    FrameConstants constants;
+
+    void init() {
+        constants.projection = glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
+        constants.cameraTime = glm::vec4(0.0f);
+        for (int layer = 0; layer < LAYER_COUNT; layer++)
+            constants.parallax[layer / 4][layer % 4] = layerParallax[layer];
+        glGenBuffers(1, &ubo);
+        glState.bindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), &constants, GL_DYNAMIC_DRAW);
+        glState.bindBufferBase(GL_UNIFORM_BUFFER, FRAME_CONSTANTS_BINDING, ubo);
+    }
+
+    // Point a program's FrameConstants block at the shared binding
+    static void attach(unsigned int program) {
+        unsigned int block = glGetUniformBlockIndex(program, "FrameConstants");
+        if (block != GL_INVALID_INDEX)
+            glUniformBlockBinding(program, block, FRAME_CONSTANTS_BINDING);
+    }
+
+    void update(float cameraOffset, float time) {
+        constants.cameraTime = glm::vec4(cameraOffset, time, 0.0f, 0.0f);
+        glState.bindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameConstants), &constants);
+    }
+
+    void destroy() {
+        glDeleteBuffers(1, &ubo);
+    }
+};
+
+// Per-instance attributes of the instanced shader
+struct SpriteInstance {
+    float x, y;             // Center in world space; the shader applies camera and parallax
+    float width, height;    // Scale applied to the unit mesh
+    glm::vec4 color;
+    glm::vec4 anim;         // Phase, amplitude, frequency, pulse; zero = static
+};
+
+// Sine animation evaluated by the instanced shader at the frame's time:
+// wave = sin(time * frequency + phase), y += amplitude * wave, size *= 1 + pulse * wave
+inline glm::vec4 spriteAnim(float phase, float amplitude, float frequency, float pulse) {
+    return glm::vec4(phase, amplitude, frequency, pulse);
+}
+
+// One resident instance rewritten after upload
+struct StaticChange {
+    DrawLayer layer;
+    MeshId mesh;
+    size_t index;
+};
+
+// The level's entities that never move, bucketed by layer and mesh in the
+// culler's key order. Built once per level without touching GL; backends
+// read the buckets (the software rasterizer) or upload them once and then
+// only the instances listed in changed (InstancedRenderer).
+struct StaticScene {
+    std::vector<SpriteInstance> buckets[LAYER_COUNT][MESH_COUNT];
+    size_t start[LAYER_COUNT][MESH_COUNT] = {};     // Offset of each bucket in flatten() order
+    size_t total = 0;
+    std::vector<StaticChange> changed;  // Rewritten by update() since the backend last synced
+
+    void clear() {
+        for (int layer = 0; layer < LAYER_COUNT; layer++)
+            for (int mesh = 0; mesh < MESH_COUNT; mesh++)
+                buckets[layer][mesh].clear();
+        changed.clear();
+    }
+
+    void add(DrawLayer layer, MeshId mesh, float x, float y, float width, float height,
+             const glm::vec4 &color, const glm::vec4 &anim) {
+        buckets[layer][mesh].push_back({x, y, width, height, color, anim});
+    }
+
+    // Lay the buckets out back to back, layer by layer
+    void finish() {
+        total = 0;
+        for (int layer = 0; layer < LAYER_COUNT; layer++) {
+            for (int mesh = 0; mesh < MESH_COUNT; mesh++) {
+                start[layer][mesh] = total;
+                total += buckets[layer][mesh].size();
+            }
+        }
+    }
+
+    void flatten(std::vector<SpriteInstance> &all) const {
+        all.clear();
+        all.reserve(total);
+        for (int layer = 0; layer < LAYER_COUNT; layer++)
+            for (int mesh = 0; mesh < MESH_COUNT; mesh++)
+                all.insert(all.end(), buckets[layer][mesh].begin(), buckets[layer][mesh].end());
+    }
+
+    // Rewrite one instance (e.g. hide a collected coin)
+    void update(DrawLayer layer, MeshId mesh, size_t index, const SpriteInstance &instance) {
+        buckets[layer][mesh][index] = instance;
+        changed.push_back({layer, mesh, index});
+    }
+};
+
+// Draws atlas meshes placed by center/size with one glDrawElementsInstanced
+// per slice of an instance buffer. The frame's instances arrive already
+// sorted into batches (see RenderQueue) and are uploaded with upload(); the
+// mesh only selects an index offset in the atlas.
+//
+// Instances are in world space, so entities that don't move can instead be
+// uploaded from a StaticScene into the resident static buffer once per
+// level; each frame only selects which slice of a bucket to draw.
+struct InstancedRenderer {
+    const MeshAtlas *atlas = nullptr;
+    unsigned int program = 0;
+    unsigned int vao = 0;
+    unsigned int instanceVBO = 0;
+    unsigned int staticVBO = 0;
+    size_t capacity = 0;    // Instance buffer size, in instances
+    int layerLocation = -1;
+    int shapeLocation = -1;     // SDF programs only: which shape the mesh's quad holds
+    std::pair<unsigned int, size_t> attribSource;   // Buffer and first instance the attributes point at
+    size_t uploadedBytes = 0;   // Instance bytes sent to the GPU since the last beginFrame
+
+    size_t staticStart[LAYER_COUNT][MESH_COUNT] = {};  // Bucket offsets in staticVBO
+
+    void init(const MeshAtlas &meshAtlas, unsigned int shaderProgram) {
+        atlas = &meshAtlas;
+        program = shaderProgram;
+        layerLocation = glGetUniformLocation(program, "uLayer");
+        shapeLocation = glGetUniformLocation(program, "uShape");
+        FrameUniformBuffer::attach(program);
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &instanceVBO);
+        glGenBuffers(1, &staticVBO);
+
+        glState.bindVertexArray(vao);
+        glState.bindBuffer(GL_ARRAY_BUFFER, atlas->vbo);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void *)0);
+        glEnableVertexAttribArray(0);
+        glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, atlas->ebo);
+
+        glState.bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+        glEnableVertexAttribArray(3);
+        glVertexAttribDivisor(1, 1);
+        glVertexAttribDivisor(2, 1);
+        glVertexAttribDivisor(3, 1);
+        setInstanceOffset(instanceVBO, 0);
+    }
+
+    void beginFrame() {
+        uploadedBytes = 0;
+    }
+
+    // Upload every bucket of a finished scene into the static buffer; it
+    // stays resident until the next level
+    void uploadStatic(StaticScene &scene) {
+        std::vector<SpriteInstance> all;
+        scene.flatten(all);
+        std::copy(&scene.start[0][0], &scene.start[0][0] + LAYER_COUNT * MESH_COUNT, &staticStart[0][0]);
+        glState.bindBuffer(GL_ARRAY_BUFFER, staticVBO);
+        glBufferData(GL_ARRAY_BUFFER, all.size() * sizeof(SpriteInstance), all.data(), GL_STATIC_DRAW);
+        uploadedBytes += all.size() * sizeof(SpriteInstance);
+        scene.changed.clear();
+    }
+
+    // Rewrite the resident instances the scene changed since the last sync
+    // (e.g. hidden collected coins)
+    void syncStatic(StaticScene &scene) {
+        if (scene.changed.empty())
+            return;
+        glState.bindBuffer(GL_ARRAY_BUFFER, staticVBO);
+        for (const StaticChange &change : scene.changed) {
+            glBufferSubData(GL_ARRAY_BUFFER, (staticStart[change.layer][change.mesh] + change.index) * sizeof(SpriteInstance),
+                            sizeof(SpriteInstance), &scene.buckets[change.layer][change.mesh][change.index]);
+            uploadedBytes += sizeof(SpriteInstance);
+        }
+        scene.changed.clear();
+    }
+
+    // Upload the frame's instances into the instance buffer, once per frame
+    void upload(const std::vector<SpriteInstance> &frameInstances) {
+        glState.bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        if (frameInstances.size() > capacity)
+            capacity = frameInstances.size() * 2;
+        // Re-specify (orphan) the storage so the driver doesn't wait on last frame's draws
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(SpriteInstance), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, frameInstances.size() * sizeof(SpriteInstance), frameInstances.data());
+        uploadedBytes += frameInstances.size() * sizeof(SpriteInstance);
+    }
+
+    // Draw instances [first, first + count) of a static bucket
+    void drawStatic(DrawLayer layer, MeshId mesh, size_t first, size_t count) {
+        if (count > 0)
+            drawSlice(layer, mesh, staticVBO, staticStart[layer][mesh] + first, count);
+    }
+
+    // One instanced draw of instances [first, first + count) of buffer, which
+    // may belong to another renderer with the same layout
+    void drawSlice(DrawLayer layer, MeshId mesh, unsigned int buffer, size_t first, size_t count) {
+        const MeshRange &range = atlas->range(mesh);
+        glState.useProgram(program);
+        glState.uniform1i(layerLocation, layer);
+        glState.uniform1i(shapeLocation, sdfShape(mesh));
+        glState.bindVertexArray(vao);
+        glState.bindBuffer(GL_ARRAY_BUFFER, buffer);
+        setInstanceOffset(buffer, first);
+        glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)range.indexCount, GL_UNSIGNED_INT,
+                                (void *)(range.firstIndex * sizeof(uint32_t)), (GLsizei)count);
+    }
+
+    void destroy() {
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &instanceVBO);
+        glDeleteBuffers(1, &staticVBO);
+        glDeleteProgram(program);
+    }
+
+    // GL 3.3 has no base-instance draws, so point the attributes at the
+    // bucket's slice. The pointers are VAO state, so they are shadowed here.
+    void setInstanceOffset(unsigned int buffer, size_t first) {
+        if (!glState.change(attribSource, std::make_pair(buffer, first), 3))
+            return;
+        size_t base = first * sizeof(SpriteInstance);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void *)base);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance),
+                              (void *)(base + offsetof(SpriteInstance, color)));
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance),
+                              (void *)(base + offsetof(SpriteInstance, anim)));
+    }
+};
@@ -0,0 +1,253 @@
+#pragma once
+#include "Simulation.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Button bits of one tick's input
+enum InputBits {
+    INPUT_LEFT = 1 << 0,
+    INPUT_RIGHT = 1 << 1,
+    INPUT_JUMP = 1 << 2,
+    INPUT_RESTART = 1 << 3,
+};
+
+inline uint8_t encodeInput(const InputState &input) {
+    return (input.left ? INPUT_LEFT : 0) | (input.right ? INPUT_RIGHT : 0) |
+           (input.jump ? INPUT_JUMP : 0) | (input.restart ? INPUT_RESTART : 0);
+}
+
+inline InputState decodeInput(uint8_t bits) {
+    InputState input;
+    input.left = (bits & INPUT_LEFT) != 0;
+    input.right = (bits & INPUT_RIGHT) != 0;
+    input.jump = (bits & INPUT_JUMP) != 0;
+    input.restart = (bits & INPUT_RESTART) != 0;
+    return input;
+}
+
+// FNV-1a over the simulation state. Floats are hashed by bit pattern, so any
+// divergence between two runs shows up on the tick it happens.
+struct StateHasher {
+    uint32_t hash = 2166136261u;
+
+    void bytes(const void *data, size_t size) {
+        const unsigned char *p = (const unsigned char *)data;
+        for (size_t i = 0; i < size; i++) {
+            hash ^= p[i];
+            hash *= 16777619u;
+        }
+    }
+    void add(float value) { bytes(&value, sizeof(value)); }
+    void add(int value) { bytes(&value, sizeof(value)); }
+    void add(bool value) { add(value ? 1 : 0); }
+};
+
+uint32_t hashWorld(const World &world)
+{
+    StateHasher h;
+    const Player &p = world.player;
+    h.add(p.x); h.add(p.y); h.add(p.velocityY); h.add(p.isJumping); h.add(p.facingRight);
+    h.add(p.animTime); h.add(p.animFrame);
+    for (size_t i = 0; i < world.platforms.size(); i++) {
+        h.add(world.platforms.y[i]);
+    }
+    for (size_t i = 0; i < world.enemies.size(); i++) {
+        h.add(world.enemies.x[i]); h.add(world.enemies.velocity[i]);
+    }
+    for (size_t i = 0; i < world.coins.size(); i++)
+        h.add(world.coins.collected.test(i));
+    for (const Cloud &cloud : world.clouds)
+        h.add(cloud.bounceOffset);
+    for (const Bird &bird : world.birds) {
+        h.add(bird.x); h.add(bird.movingRight);
+    }
+    h.add(world.cameraOffset); h.add(world.worldTime);
+    h.add(world.gameOver); h.add(world.gameWin); h.add(world.score);
+    return h.hash;
+}
+
+const uint32_t REPLAY_VERSION = 3;     // 2: cosmetic animation left the hashed state; 3: platforms share one float timer
+
+// A run of ticks with identical buttons
+struct InputRun {
+    uint8_t bits;
+    uint32_t length;
+};
+
+// Recorded session: the seed and tick rate it was played at, the per-tick
+// input run-length encoded, and a state hash every checkpointInterval ticks
+// to detect desyncs on replay.
+//
+// File layout (little-endian): "PLRP", version, seed, tick rate, tick count,
+// run count, runs as (bits byte, varint length), checkpoint interval,
+// checkpoint count, checkpoint hashes.
+struct InputLog {
+    uint32_t seed = 1;
+    float tickRate = SIM_TICK_RATE;
+    uint64_t tickCount = 0;
+    std::vector<InputRun> runs;
+    uint32_t checkpointInterval = 60;
+    std::vector<uint32_t> checkpoints;  // Hash after tick (i + 1) * checkpointInterval
+
+    // Append one tick's input
+    void record(const InputState &input) {
+        uint8_t bits = encodeInput(input);
+        if (!runs.empty() && runs.back().bits == bits)
+            runs.back().length++;
+        else
+            runs.push_back({bits, 1});
+        tickCount++;
+    }
+
+    // Called after each recorded tick has been simulated
+    void recordState(const World &world) {
+        if (tickCount % checkpointInterval == 0)
+            checkpoints.push_back(hashWorld(world));
+    }
+
+    bool save(const std::string &path) const {
+        std::ofstream out(path, std::ios::binary);
+        if (!out) {
+            std::cout << "ERROR::REPLAY::CANNOT_WRITE " << path << std::endl;
+            return false;
+        }
+        out.write("PLRP", 4);
+        write(out, REPLAY_VERSION);
+        write(out, seed);
+        write(out, tickRate);
+        write(out, tickCount);
+        write(out, (uint32_t)runs.size());
+        for (const InputRun &run : runs) {
+            out.put((char)run.bits);
+            uint32_t length = run.length;
+            while (length >= 0x80) {
+                out.put((char)((length & 0x7f) | 0x80));
+                length >>= 7;
+            }
+            out.put((char)length);
+        }
+        write(out, checkpointInterval);
+        write(out, (uint32_t)checkpoints.size());
+        out.write((const char *)checkpoints.data(), checkpoints.size() * sizeof(uint32_t));
+        return (bool)out;
+    }
+
+    bool load(const std::string &path) {
+        std::ifstream in(path, std::ios::binary);
+        char magic[4] = {};
+        uint32_t version = 0, runCount = 0, checkpointCount = 0;
+        in.read(magic, 4);
+        read(in, version);
+        if (!in || std::memcmp(magic, "PLRP", 4) != 0 || version != REPLAY_VERSION) {
+            std::cout << "ERROR::REPLAY::BAD_FILE " << path << std::endl;
+            return false;
+        }
+        read(in, seed);
+        read(in, tickRate);
+        read(in, tickCount);
+        read(in, runCount);
+        runs.clear();
+        for (uint32_t i = 0; i < runCount && in; i++) {
+            InputRun run = {(uint8_t)in.get(), 0};
+            for (int shift = 0; in; shift += 7) {
+                int byte = in.get();
+                run.length |= (uint32_t)(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    break;
+            }
+            runs.push_back(run);
+        }
+        read(in, checkpointInterval);
+        read(in, checkpointCount);
+        checkpoints.resize(in ? checkpointCount : 0);
+        in.read((char *)checkpoints.data(), checkpoints.size() * sizeof(uint32_t));
+        if (!in || checkpointInterval == 0) {
+            std::cout << "ERROR::REPLAY::TRUNCATED " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    template <typename T> static void write(std::ofstream &out, const T &value) {
+        out.write((const char *)&value, sizeof(T));
+    }
+    template <typename T> static void read(std::ifstream &in, T &value) {
+        in.read((char *)&value, sizeof(T));
+    }
+};
+
+// Walks an InputLog's runs one tick at a time
+struct InputPlayer {
+    const InputLog *log;
+    size_t run = 0;
+    uint32_t used = 0;
+
+    explicit InputPlayer(const InputLog &inputLog) : log(&inputLog) {}
+
+    bool next(InputState &input) {
+        while (run < log->runs.size() && used >= log->runs[run].length) {
+            run++;
+            used = 0;
+        }
+        if (run >= log->runs.size())
+            return false;
+        input = decodeInput(log->runs[run].bits);
+        used++;
+        return true;
+    }
+};
+
+// Re-simulate a recorded session without a window, printing the state hash
+// of every tick and checking it against the recorded checkpoints. level,
+// and stream for an endless session, must be what the session was played
+// on. Returns false if the file can't be read or the replay desyncs.
+bool runReplay(const std::string &path, const LevelView &level, LevelStream *stream)
+{
+    InputLog log;
+    if (!log.load(path))
+        return false;
+
+    World world;
+    world.level = level;
+    world.stream = stream;
+    world.seed = log.seed;
+    restartWorld(world);
+    const float dt = 1.0f / log.tickRate;
+
+    InputPlayer player(log);
+    InputState input;
+    uint64_t tick = 0;
+    long long firstDesync = -1;
+    while (player.next(input))
+    {
+        if (world.gameOver || world.gameWin)
+            restartWorld(world);
+        stepWorld(world, input, dt);
+        tick++;
+
+        uint32_t hash = hashWorld(world);
+        std::cout << "tick " << tick << " " << std::hex << std::setw(8) << std::setfill('0') << hash
+                  << std::dec << "\n";
+        if (tick % log.checkpointInterval == 0)
+        {
+            size_t checkpoint = tick / log.checkpointInterval - 1;
+            if (checkpoint < log.checkpoints.size() && log.checkpoints[checkpoint] != hash && firstDesync < 0)
+                firstDesync = (long long)tick;
+        }
+    }
+
+    std::cout << "replay: " << tick << " ticks at " << log.tickRate << " Hz, seed " << log.seed
+              << ", " << log.runs.size() << " input runs, final score " << world.score << "\n";
+    if (firstDesync >= 0)
+    {
+        std::cout << "replay: DESYNC, first mismatching checkpoint at tick " << firstDesync << std::endl;
+        return false;
+    }
+    std::cout << "replay: all " << log.checkpoints.size() << " checkpoints match" << std::endl;
+    return true;
+}
@@ -0,0 +1,483 @@
+#pragma once
+#include "Simulation.h"
+#include "Replay.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+const int REWIND_KEYFRAME_INTERVAL = 60;            // Ticks per keyframe; the rest are deltas against it
+const size_t REWIND_MAX_BYTES = 64u << 20;          // History storage cap; big levels hold fewer seconds
+
+// History held, as of the last recorded tick
+struct RewindStats {
+    size_t frames = 0;
+    size_t keyframes = 0;
+    float seconds = 0.0f;
+    size_t usedBytes = 0;       // Encoded frames
+    size_t capacityBytes = 0;   // Storage allocated for them
+    size_t stateBytes = 0;      // One raw state
+    float bytesPerSecond = 0.0f;
+    float rawBytesPerSecond = 0.0f;
+};
+
+// The per-tick state a rewind restores, as 32-bit words: player, camera,
+// clock, score and outcome, then enemy positions and velocities, collected
+// coin bits and birds. Platforms are not stored: every float timer equals
+// worldTime, so their heights follow from it. Geometry and scenery never
+// change while a level is loaded.
+const size_t REWIND_HEADER_WORDS = 12;
+
+size_t rewindStateWords(const World &world)
+{
+    return REWIND_HEADER_WORDS + world.enemies.size() * 2 + world.coins.collected.words.size() * 2 +
+           world.birds.size() * 2;
+}
+
+inline uint32_t floatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, 4);
+    return bits;
+}
+
+inline float bitsFloat(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, 4);
+    return value;
+}
+
+void gatherRewindState(const World &world, uint32_t *words)
+{
+    const Player &p = world.player;
+    *words++ = floatBits(p.x);
+    *words++ = floatBits(p.y);
+    *words++ = floatBits(p.velocityY);
+    *words++ = p.isJumping;
+    *words++ = p.facingRight;
+    *words++ = floatBits(p.animTime);
+    *words++ = (uint32_t)p.animFrame;
+    *words++ = floatBits(world.cameraOffset);
+    *words++ = floatBits(world.worldTime);
+    *words++ = (uint32_t)world.score;
+    *words++ = world.gameOver;
+    *words++ = world.gameWin;
+
+    const EnemyStore &enemies = world.enemies;
+    for (size_t i = 0; i < enemies.size(); i++)
+        *words++ = floatBits(enemies.x[i]);
+    for (size_t i = 0; i < enemies.size(); i++)
+        *words++ = floatBits(enemies.velocity[i]);
+    for (uint64_t word : world.coins.collected.words)
+    {
+        *words++ = (uint32_t)word;
+        *words++ = (uint32_t)(word >> 32);
+    }
+    for (const Bird &bird : world.birds)
+    {
+        *words++ = floatBits(bird.x);
+        *words++ = bird.movingRight;
+    }
+}
+
+// Put a gathered state back. Previous-tick positions are set to the current
+// ones, so the rewound frame renders without interpolating from the future.
+void scatterRewindState(World &world, const uint32_t *words)
+{
+    Player &p = world.player;
+    p.x = bitsFloat(*words++);
+    p.y = bitsFloat(*words++);
+    p.velocityY = bitsFloat(*words++);
+    p.isJumping = *words++ != 0;
+    p.facingRight = *words++ != 0;
+    p.animTime = bitsFloat(*words++);
+    p.animFrame = (int)*words++;
+    p.prevX = p.x;
+    p.prevY = p.y;
+    world.cameraOffset = bitsFloat(*words++);
+    world.prevCameraOffset = world.cameraOffset;
+    world.worldTime = bitsFloat(*words++);
+    world.score = (int)*words++;
+    world.gameOver = *words++ != 0;
+    world.gameWin = *words++ != 0;
+
+    // stepWorld's float wave
+    PlatformStore &platforms = world.platforms;
+    auto wave = sin(world.worldTime * PLATFORM_FLOAT_SPEED) * PLATFORM_FLOAT_AMPLITUDE;
+    for (size_t i = 0; i < platforms.size(); i++)
+        platforms.y[i] = platforms.initialY[i] + wave;
+
+    EnemyStore &enemies = world.enemies;
+    for (size_t i = 0; i < enemies.size(); i++)
+        enemies.x[i] = bitsFloat(*words++);
+    for (size_t i = 0; i < enemies.size(); i++)
+        enemies.velocity[i] = bitsFloat(*words++);
+    enemies.prevX = enemies.x;
+    for (size_t i = 0; i < enemies.size(); i++)
+        world.enemyGrid.update((uint32_t)i, centeredBox(enemies.x[i], enemies.y[i], enemies.width[i], enemies.height[i]));
+    for (uint64_t &word : world.coins.collected.words)
+    {
+        word = words[0] | (uint64_t)words[1] << 32;
+        words += 2;
+    }
+    for (Bird &bird : world.birds)
+    {
+        bird.x = bitsFloat(*words++);
+        bird.prevX = bird.x;
+        bird.movingRight = *words++ != 0;
+    }
+}
+
+// Byte planes of a state: byte 0 of every word, then byte 1, and so on. A
+// float that changed a little differs only in its low bytes, so XORed
+// planes turn the high ones into long zero runs.
+void toPlanes(const uint32_t *words, size_t count, uint8_t *planes)
+{
+    uint8_t *p0 = planes, *p1 = p0 + count, *p2 = p1 + count, *p3 = p2 + count;
+    for (size_t i = 0; i < count; i++)
+    {
+        p0[i] = (uint8_t)words[i];
+        p1[i] = (uint8_t)(words[i] >> 8);
+        p2[i] = (uint8_t)(words[i] >> 16);
+        p3[i] = (uint8_t)(words[i] >> 24);
+    }
+}
+
+void fromPlanes(const uint8_t *planes, size_t count, uint32_t *words)
+{
+    const uint8_t *p0 = planes, *p1 = p0 + count, *p2 = p1 + count, *p3 = p2 + count;
+    for (size_t i = 0; i < count; i++)
+        words[i] = p0[i] | (uint32_t)p1[i] << 8 | (uint32_t)p2[i] << 16 | (uint32_t)p3[i] << 24;
+}
+
+inline uint8_t *writeVarint(uint8_t *out, size_t value) {
+    while (value >= 0x80) {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+inline const uint8_t *readVarint(const uint8_t *in, size_t &value) {
+    value = 0;
+    for (int shift = 0;; shift += 7) {
+        value |= (size_t)(*in & 0x7f) << shift;
+        if (!(*in++ & 0x80))
+            return in;
+    }
+}
+
+// Zero-run encoding: pairs of zero run length and literal bytes. Zero runs
+// are found eight bytes at a time; a literal run ends at the first pair of
+// zero bytes, since a lone zero is cheaper inline. Returns the encoded size;
+// out needs room for rewindEncodedBound(size) bytes.
+size_t encodeZeroRuns(const uint8_t *data, size_t size, uint8_t *out)
+{
+    uint8_t *start = out;
+    size_t i = 0;
+    while (i < size)
+    {
+        size_t zeros = i;
+        uint64_t chunk;
+        while (zeros + 8 <= size && (std::memcpy(&chunk, data + zeros, 8), chunk == 0))
+            zeros += 8;
+        while (zeros < size && data[zeros] == 0)
+            zeros++;
+        size_t end = zeros;
+        for (;;)
+        {
+            const void *zero = std::memchr(data + end, 0, size - end);
+            end = zero ? (const uint8_t *)zero - data : size;
+            if (end + 1 >= size || data[end + 1] == 0)
+                break;
+            end++;
+        }
+        out = writeVarint(out, zeros - i);
+        out = writeVarint(out, end - zeros);
+        std::memcpy(out, data + zeros, end - zeros);
+        out += end - zeros;
+        i = end;
+    }
+    return out - start;
+}
+
+inline size_t rewindEncodedBound(size_t size) {
+    return size + size / 2 + 32;
+}
+
+void decodeZeroRuns(const uint8_t *in, size_t encodedSize, uint8_t *data, size_t size)
+{
+    const uint8_t *end = in + encodedSize;
+    size_t i = 0;
+    while (in < end)
+    {
+        size_t zeros, literals;
+        in = readVarint(in, zeros);
+        in = readVarint(in, literals);
+        std::memset(data + i, 0, zeros);
+        std::memcpy(data + i + zeros, in, literals);
+        in += literals;
+        i += zeros + literals;
+    }
+    std::memset(data + i, 0, size - i);
+}
+
+// a ^= b over size bytes
+void xorBytes(uint8_t *a, const uint8_t *b, size_t size)
+{
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t x, y;
+        std::memcpy(&x, a + i, 8);
+        std::memcpy(&y, b + i, 8);
+        x ^= y;
+        std::memcpy(a + i, &x, 8);
+    }
+    for (; i < size; i++)
+        a[i] ^= b[i];
+}
+
+// The last few seconds of world state, one frame per tick, for rewinding.
+// Every REWIND_KEYFRAME_INTERVAL ticks a keyframe stores the state on its
+// own; the frames between store their XOR against it. Both are zero-run
+// encoded into one fixed circular byte buffer, oldest frames dropped first.
+// A keyframe and its deltas are dropped together, so a keyframe is also
+// taken early once its deltas fill a quarter of the buffer.
+//
+// Frames hold the entity state of one level build; when the world's
+// generation changes (a rebuilt level, or an endless level's window moving)
+// the history starts over.
+struct RewindBuffer {
+    struct Frame {
+        size_t offset = 0, size = 0;
+        long long keySerial = 0;        // Serial of the keyframe it is a delta against; its own for a keyframe
+    };
+
+    std::vector<Frame> frames;          // Ring indexed by serial % capacity
+    size_t capacityFrames = 0;
+    long long first = 0, next = 0;      // Serials held: [first, next)
+    std::vector<uint8_t> bytes;         // Circular store of encoded frames
+    size_t writeOffset = 0;
+    size_t usedBytes = 0;
+    size_t keyframes = 0;
+    float tickSeconds = 0.0f;
+    uint32_t generation = UINT32_MAX;
+
+    size_t stateWords = 0;
+    std::vector<uint32_t> words;
+    std::vector<uint8_t> planes, keyPlanes, scratch;
+    long long keySerial = -1;           // Keyframe keyPlanes holds
+    size_t keyGroupBytes = 0;           // Encoded size of that keyframe and its deltas
+
+    // Hold seconds of history at tickRate ticks a second; 0 disables recording
+    void init(float seconds, float tickRate) {
+        tickSeconds = 1.0f / tickRate;
+        if (seconds <= 0.0f)
+            return;
+        // A keyframe interval over, since frames are dropped a keyframe at a time
+        capacityFrames = (size_t)std::ceil(seconds * tickRate) + REWIND_KEYFRAME_INTERVAL;
+        frames.assign(capacityFrames, Frame());
+        generation = UINT32_MAX;
+    }
+
+    bool enabled() const {
+        return capacityFrames > 0;
+    }
+
+    // Size the buffers for the world's current level and drop the history
+    void reset(const World &world) {
+        generation = world.generation;
+        stateWords = rewindStateWords(world);
+        words.resize(stateWords);
+        planes.resize(stateWords * 4);
+        keyPlanes.resize(stateWords * 4);
+        scratch.resize(rewindEncodedBound(stateWords * 4));
+        // Room for every frame raw, up to the cap, and always for a few
+        size_t wanted = std::min(capacityFrames * scratch.size(), REWIND_MAX_BYTES);
+        bytes.resize(std::max(wanted, scratch.size() * 4));
+        first = next = 0;
+        writeOffset = usedBytes = keyframes = 0;
+        keySerial = -1;
+        keyGroupBytes = 0;
+    }
+
+    Frame &frame(long long serial) {
+        return frames[(size_t)(serial % (long long)capacityFrames)];
+    }
+
+    void dropOldest() {
+        Frame &oldest = frame(first);
+        usedBytes -= oldest.size;
+        keyframes -= oldest.keySerial == first;
+        first++;
+    }
+
+    // Drop the oldest frames until [offset, offset + size) is free, then any
+    // deltas whose keyframe went with them
+    void makeRoom(size_t offset, size_t size) {
+        while (first < next) {
+            const Frame &oldest = frame(first);
+            bool overlaps = oldest.offset < offset + size && offset < oldest.offset + oldest.size;
+            if (!overlaps && next - first < (long long)capacityFrames)
+                break;
+            dropOldest();
+        }
+        while (first < next && frame(first).keySerial < first)
+            dropOldest();
+        if (first == next)
+            usedBytes = 0;
+    }
+
+    // Offset for a record of size bytes, with the frames in its way dropped.
+    // Records are never split: one that does not fit before the end starts
+    // over at 0.
+    size_t place(size_t size) {
+        size_t offset = writeOffset + size <= bytes.size() ? writeOffset : 0;
+        if (offset == 0 && writeOffset != 0)
+            makeRoom(writeOffset, bytes.size() - writeOffset);
+        makeRoom(offset, size);
+        return offset;
+    }
+
+    // Store the world's state after a tick
+    void record(const World &world) {
+        if (!enabled())
+            return;
+        if (world.generation != generation)
+            reset(world);
+
+        gatherRewindState(world, words.data());
+        toPlanes(words.data(), stateWords, planes.data());
+        bool key = keySerial < first || next - keySerial >= REWIND_KEYFRAME_INTERVAL ||
+                   keyGroupBytes >= bytes.size() / 4;
+        if (!key)
+            xorBytes(planes.data(), keyPlanes.data(), planes.size());
+        size_t size = encodeZeroRuns(planes.data(), planes.size(), scratch.data());
+        size_t offset = place(size);
+        if (!key && keySerial < first) {
+            // Making room dropped the keyframe this delta is against; store a keyframe instead
+            key = true;
+            xorBytes(planes.data(), keyPlanes.data(), planes.size());
+            size = encodeZeroRuns(planes.data(), planes.size(), scratch.data());
+            offset = place(size);
+        }
+        if (key) {
+            keyPlanes.swap(planes);
+            keySerial = next;
+            keyGroupBytes = 0;
+        }
+        keyGroupBytes += size;
+
+        std::memcpy(bytes.data() + offset, scratch.data(), size);
+        Frame &added = frame(next);
+        added.offset = offset;
+        added.size = size;
+        added.keySerial = keySerial;
+        next++;
+        writeOffset = offset + size;
+        usedBytes += size;
+        keyframes += key;
+    }
+
+    // Step back one tick: drop the newest frame and restore the one before
+    // it. False, with the world untouched, if there is nothing to go back to.
+    bool rewind(World &world) {
+        if (!enabled() || world.generation != generation || next - first < 2)
+            return false;
+        const Frame &dropped = frame(next - 1);
+        usedBytes -= dropped.size;
+        keyframes -= dropped.keySerial == next - 1;
+        next--;
+
+        const Frame &newest = frame(next - 1);
+        if (newest.keySerial != keySerial) {
+            const Frame &keyframe = frame(newest.keySerial);
+            decodeZeroRuns(bytes.data() + keyframe.offset, keyframe.size, keyPlanes.data(), keyPlanes.size());
+            keySerial = newest.keySerial;
+        }
+        keyGroupBytes = 0;
+        for (long long serial = keySerial; serial < next; serial++)
+            keyGroupBytes += frame(serial).size;
+        if (keySerial == next - 1) {
+            fromPlanes(keyPlanes.data(), stateWords, words.data());
+        } else {
+            decodeZeroRuns(bytes.data() + newest.offset, newest.size, planes.data(), planes.size());
+            xorBytes(planes.data(), keyPlanes.data(), planes.size());
+            fromPlanes(planes.data(), stateWords, words.data());
+        }
+        scatterRewindState(world, words.data());
+        writeOffset = newest.offset + newest.size;
+        return true;
+    }
+
+    RewindStats stats() const {
+        RewindStats result;
+        result.frames = (size_t)(next - first);
+        result.keyframes = keyframes;
+        result.seconds = result.frames * tickSeconds;
+        result.usedBytes = usedBytes;
+        result.capacityBytes = bytes.size();
+        result.stateBytes = stateWords * 4;
+        result.bytesPerSecond = result.seconds > 0.0f ? usedBytes / result.seconds : 0.0f;
+        result.rawBytesPerSecond = result.stateBytes / tickSeconds;
+        return result;
+    }
+};
+
+// Record the scripted headless run (see headlessInput) on level for ticks
+// ticks, then rewind the whole history, checking every restored state's
+// hash against the one recorded live, and report the cost of each and the
+// memory the history takes
+void runRewindBenchmark(long long ticks, float seconds, float tickRate, uint32_t seed, const LevelView &level)
+{
+    World world;
+    world.level = level;
+    world.seed = seed;
+    restartWorld(world);
+    RewindBuffer rewind;
+    rewind.init(seconds, tickRate);
+    const float dt = 1.0f / tickRate;
+    std::vector<uint32_t> hashes;     // Live hash of every tick, newest last
+
+    double recordSeconds = 0.0;
+    for (long long tick = 0; tick < ticks; tick++)
+    {
+        if (world.gameOver || world.gameWin)
+            restartWorld(world);
+        stepWorld(world, headlessInput(world), dt);
+        auto start = std::chrono::steady_clock::now();
+        rewind.record(world);
+        recordSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        hashes.push_back(hashWorld(world));
+    }
+    RewindStats stats = rewind.stats();
+
+    long long rewound = 0, mismatches = 0;
+    double rewindSeconds = 0.0;
+    for (;;)
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool stepped = rewind.rewind(world);
+        rewindSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!stepped)
+            break;
+        hashes.pop_back();
+        mismatches += hashWorld(world) != hashes.back();
+        rewound++;
+    }
+
+    std::cout << "rewind: " << ticks << " ticks recorded, " << recordSeconds * 1000.0 / (ticks > 0 ? ticks : 1)
+              << " ms/tick; " << stats.stateBytes << " bytes of state per tick\n"
+              << "rewind: holding " << stats.seconds << " s (" << stats.frames << " frames, " << stats.keyframes
+              << " keyframes) in " << stats.usedBytes << " of " << stats.capacityBytes << " bytes\n"
+              << "rewind: " << stats.bytesPerSecond << " bytes per second of history, "
+              << stats.rawBytesPerSecond << " raw ("
+              << (stats.bytesPerSecond > 0.0f ? stats.rawBytesPerSecond / stats.bytesPerSecond : 0.0f) << "x)\n"
+              << "rewind: " << rewound << " ticks rewound, " << rewindSeconds * 1000.0 / (rewound > 0 ? rewound : 1)
+              << " ms/tick; states " << (mismatches == 0 ? "match" : "DIFFER") << std::endl;
+}
@@ -1,19 +1,125 @@
 #pragma once
 
-// Vertex shader source
-const char *vertexShaderSource = "#version 330 core\n"
-    "layout (location = 0) in vec3 aPos;\n"
-    "uniform mat4 transform;\n"
+// Per-frame constants shared by every program (FrameConstants in Renderer.h).
+// Positions arrive in world space; the layer's parallax scales the camera offset.
+#define FRAME_CONSTANTS_GLSL \
+    "layout (std140) uniform FrameConstants\n" \
+    "{\n" \
+    "   mat4 projection;\n" \
+    "   vec4 cameraTime;\n"    /* x = camera offset, y = time */ \
+    "   vec4 parallax[3];\n"   /* one factor per layer, four per vec4 */ \
+    "};\n" \
+    "uniform int uLayer;\n" \
+    "vec4 worldToClip(vec2 p)\n" \
+    "{\n" \
+    "   p.x -= cameraTime.x * parallax[uLayer / 4][uLayer % 4];\n" \
+    "   return projection * vec4(p, 0.0, 1.0);\n" \
+    "}\n"
+
+// Instanced vertex shader: atlas unit mesh placed by per-instance center/size.
+// Cosmetic motion is evaluated here from the frame time: one sine wave per
+// instance that bobs the center vertically and/or pulses the size.
+const char *instancedVertexShaderSource = "#version 330 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "layout (location = 1) in vec4 aRect;\n"   // xy = center, zw = size
+    "layout (location = 2) in vec4 aColor;\n"
+    "layout (location = 3) in vec4 aAnim;\n"   // phase, amplitude, frequency, pulse
+    FRAME_CONSTANTS_GLSL
+    "out vec4 vColor;\n"
+    "out vec2 vLocal;\n"     // Mesh-space position, for the SDF fragment shader
+    "void main()\n"
+    "{\n"
+    "   float wave = sin(cameraTime.y * aAnim.z + aAnim.x);\n"
+    "   vec2 center = aRect.xy + vec2(0.0, aAnim.y * wave);\n"
+    "   vec2 size = aRect.zw * (1.0 + aAnim.w * wave);\n"
+    "   gl_Position = worldToClip(center + aPos * size);\n"
+    "   vColor = aColor;\n"
+    "   vLocal = aPos;\n"
+    "}\0";
+
+// Sprite batch vertex shader: pre-transformed, per-vertex colored triangles
+const char *spriteBatchVertexShaderSource = "#version 330 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "layout (location = 1) in vec4 aColor;\n"
+    FRAME_CONSTANTS_GLSL
+    "out vec4 vColor;\n"
     "void main()\n"
     "{\n"
-    "   gl_Position = transform * vec4(aPos, 1.0);\n"
+    "   gl_Position = worldToClip(aPos);\n"
+    "   vColor = aColor;\n"
     "}\0";
 
-// Fragment shader source
-const char *fragmentShaderSource = "#version 330 core\n"
+// SDF fragment shader for the MESH_SDF_* quads drawn by the instanced vertex
+// shader: evaluates the signed distance to the shape (uShape, see sdfShape)
+// and turns the last pixel of it into coverage, so edges are antialiased
+// without any tessellation. Needs alpha blending.
+const char *sdfFragmentShaderSource = "#version 330 core\n"
+    "in vec4 vColor;\n"
+    "in vec2 vLocal;\n"
+    FRAME_CONSTANTS_GLSL
+    "uniform int uShape;\n"   // 0 = circle, 1 = cloud, 2 = sun rays
+    "out vec4 FragColor;\n"
+    "float circle(vec2 p, vec2 center, float radius)\n"
+    "{\n"
+    "   return length(p - center) - radius;\n"
+    "}\n"
+    "float triangle(vec2 p, vec2 a, vec2 b, vec2 c)\n"
+    "{\n"
+    "   vec2 e0 = b - a, e1 = c - b, e2 = a - c;\n"
+    "   vec2 v0 = p - a, v1 = p - b, v2 = p - c;\n"
+    "   vec2 q0 = v0 - e0 * clamp(dot(v0, e0) / dot(e0, e0), 0.0, 1.0);\n"
+    "   vec2 q1 = v1 - e1 * clamp(dot(v1, e1) / dot(e1, e1), 0.0, 1.0);\n"
+    "   vec2 q2 = v2 - e2 * clamp(dot(v2, e2) / dot(e2, e2), 0.0, 1.0);\n"
+    "   float s = sign(e0.x * e2.y - e0.y * e2.x);\n"
+    "   vec2 d = min(min(vec2(dot(q0, q0), s * (v0.x * e0.y - v0.y * e0.x)),\n"
+    "                    vec2(dot(q1, q1), s * (v1.x * e1.y - v1.y * e1.x))),\n"
+    "                vec2(dot(q2, q2), s * (v2.x * e2.y - v2.y * e2.x)));\n"
+    "   return -sqrt(d.x) * sign(d.y);\n"
+    "}\n"
+    "void main()\n"
+    "{\n"
+    "   float d;\n"
+    "   if (uShape == 0)\n"
+    "       d = circle(vLocal, vec2(0.0), 1.0);\n"
+    "   else if (uShape == 1)\n"
+    "       d = min(min(circle(vLocal, vec2(0.0), 1.0), circle(vLocal, vec2(0.8, 0.0), 0.8)),\n"
+    "               min(circle(vLocal, vec2(-0.8, 0.0), 0.9), circle(vLocal, vec2(0.0, 0.3), 0.7)));\n"
+    "   else {\n"
+    // Eight rays 45 degrees apart turning at 0.2 rad/s, 0.2 from the center;
+    // each is a 0.02 x 0.05 triangle rotated by -angle. Fold into the nearest one.
+    "       float turn = cameraTime.y * 0.2;\n"
+    "       float angle = turn + round((atan(vLocal.y, vLocal.x) - turn) / 0.7853982) * 0.7853982;\n"
+    "       float c = cos(angle), s = sin(angle);\n"
+    "       vec2 p = vLocal - 0.2 * vec2(c, s);\n"
+    "       p = vec2(c * p.x - s * p.y, s * p.x + c * p.y);\n"
+    "       d = triangle(p, vec2(-0.01, -0.025), vec2(0.01, -0.025), vec2(0.0, 0.025));\n"
+    "   }\n"
+    "   float coverage = clamp(0.5 - d / fwidth(d), 0.0, 1.0);\n"
+    "   if (coverage <= 0.0)\n"
+    "       discard;\n"
+    "   FragColor = vec4(vColor.rgb, vColor.a * coverage);\n"
+    "}\n\0";
+
+// Composites a LayerCache strip, drawn by the instanced vertex shader on
+// MESH_RECT. The strip holds premultiplied color (it was blended over
+// transparent black), so it is divided back out for the regular blend.
+const char *layerCompositeFragmentShaderSource = "#version 330 core\n"
+    "in vec2 vLocal;\n"
+    "uniform sampler2D uLayerTexture;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "   vec4 texel = texture(uLayerTexture, vLocal + 0.5);\n"
+    "   if (texel.a <= 0.0)\n"
+    "       discard;\n"
+    "   FragColor = vec4(texel.rgb / texel.a, texel.a);\n"
+    "}\n\0";
+
+// Fragment shader shared by the instanced and sprite batch programs
+const char *vertexColorFragmentShaderSource = "#version 330 core\n"
+    "in vec4 vColor;\n"
     "out vec4 FragColor;\n"
-    "uniform vec4 ourColor;\n"
     "void main()\n"
     "{\n"
-    "   FragColor = ourColor;\n"
-    "}\n\0"; 
\ No newline at end of file
+    "   FragColor = vColor;\n"
+    "}\n\0";
@@ -0,0 +1,687 @@
+#pragma once
+#include "GameConstants.h"
+#include "GameObjects.h"
+#include "EntityStore.h"
+#include "LevelFormat.h"
+#include "LevelStream.h"
+#include "Collision.h"
+#include "Broadphase.h"
+#include "Utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// Buttons sampled once per rendered frame and applied to every tick of that frame
+struct InputState {
+    bool left = false;
+    bool right = false;
+    bool jump = false;
+    bool restart = false;
+};
+
+// Fixed-rate simulation clock. Real frame time is accumulated and spent in
+// whole ticks; what is left over becomes the render interpolation factor.
+struct FixedTimestep {
+    float tickSeconds;
+    float accumulator = 0.0f;
+    int maxTicksPerFrame = 8;       // Drop time rather than spiral on slow frames
+
+    FixedTimestep(float ticksPerSecond) : tickSeconds(1.0f / ticksPerSecond) {}
+
+    // Returns how many ticks to simulate for a frame that took frameSeconds
+    int advance(float frameSeconds) {
+        if (frameSeconds > 0.25f)
+            frameSeconds = 0.25f;
+        accumulator += frameSeconds;
+
+        int ticks = 0;
+        while (accumulator >= tickSeconds && ticks < maxTicksPerFrame) {
+            accumulator -= tickSeconds;
+            ticks++;
+        }
+        if (ticks == maxTicksPerFrame && accumulator >= tickSeconds)
+            accumulator = 0.0f;
+        return ticks;
+    }
+
+    // How far the renderer is between the previous and the current tick (0..1)
+    float alpha() const {
+        return accumulator / tickSeconds;
+    }
+};
+
+// Interpolate a value between the previous and current tick
+inline float lerp(float previous, float current, float alpha) {
+    return previous + (current - previous) * alpha;
+}
+
+// The built-in level, played when no level file is given; levels/default.txt
+// is the same level in text form. Each table holds its section's columns one
+// after another, in the order LevelFormat.h lists them.
+const float builtinPlatforms[PLATFORM_COLUMNS * 5] = {
+    -1.0f, -0.3f, 0.3f, 1.0f, 1.7f,         // x
+    -0.5f, -0.5f, -0.5f, -0.5f, -0.5f,      // y
+    0.5f, 0.4f, 0.5f, 0.4f, 0.5f,           // width
+    0.1f, 0.1f, 0.1f, 0.1f, 0.1f,           // height
+};
+const float builtinEnemies[ENEMY_COLUMNS * 2] = {
+    0.3f, 1.7f,                     // x
+    -0.4f, -0.4f,                   // y
+    0.08f, 0.08f,                   // width
+    0.08f, 0.08f,                   // height
+    0.2f, 0.2f,                     // velocity
+    0.3f - 0.8f, 1.7f - 0.8f,       // patrol left
+    0.3f + 0.8f, 1.7f + 0.8f,       // patrol right
+    1.0f, 1.0f,                     // base scale
+    0.2f, 0.2f,                     // zoom amount
+    2.0f, 2.0f,                     // zoom speed
+};
+const float builtinCoins[COIN_COLUMNS * 5] = {
+    -0.6f, -0.1f, 0.5f, 0.7f, 1.4f,         // x
+    -0.2f, -0.2f, -0.2f, -0.2f, -0.2f,      // y
+    0.05f, 0.05f, 0.05f, 0.05f, 0.05f,      // width
+    0.05f, 0.05f, 0.05f, 0.05f, 0.05f,      // height
+};
+const float builtinClouds[CLOUD_COLUMNS * 8] = {
+    -0.8f, 0.4f, 1.5f, -0.2f, 0.9f, 2.0f, -1.2f, 1.2f,          // x
+    0.7f, 0.6f, 0.8f, 0.75f, 0.65f, 0.7f, 0.55f, 0.85f,         // y
+    0.1f, 0.1f, 0.1f, 0.1f, 0.1f, 0.1f, 0.1f, 0.1f,             // size
+};
+const float builtinBirds[BIRD_COLUMNS * 4] = {
+    -0.5f, 0.2f, 0.8f, 1.4f,                // x
+    0.5f, 0.4f, 0.6f, 0.5f,                 // y
+    0.0002f, 0.0002f, 0.0002f, 0.0002f,     // speed
+};
+const float builtinMountains[MOUNTAIN_COLUMNS * 4] = {
+    -0.8f, 0.2f, 1.0f, 1.8f,        // x
+    -0.7f, -0.55f, -0.55f, -0.55f,  // y
+    0.8f, 1.0f, 0.9f, 0.7f,         // width
+    0.4f, 0.5f, 0.45f, 0.35f,       // height
+    0.2f, 0.25f, 0.3f, 0.35f,       // r: dark to lighter forest green
+    0.4f, 0.45f, 0.5f, 0.55f,       // g
+    0.2f, 0.25f, 0.3f, 0.35f,       // b
+    1.0f, 1.0f, 1.0f, 1.0f,         // a
+};
+const float builtinTrees[TREE_COLUMNS * 5] = {
+    -0.9f, -0.3f, 0.4f, 1.2f, 1.9f,         // x
+    -0.4f, -0.4f, -0.4f, -0.4f, -0.4f,      // y
+    0.2f, 0.25f, 0.22f, 0.23f, 0.21f,       // size
+};
+
+LevelView builtinLevel()
+{
+    const float *tables[LEVEL_SECTION_COUNT] = {builtinPlatforms, builtinEnemies, builtinCoins, builtinClouds,
+                                                builtinBirds, builtinMountains, builtinTrees};
+    const size_t counts[LEVEL_SECTION_COUNT] = {5, 2, 5, 8, 4, 4, 5};
+    LevelView level;
+    level.playerX = -0.8f;
+    level.playerY = -0.3f;
+    level.flagX = 2.0f;
+    level.flagY = -0.3f;
+    for (int s = 0; s < LEVEL_SECTION_COUNT; s++)
+        level.sections[s] = {tables[s], counts[s], counts[s]};
+    return level;
+}
+
+// What play changes in a freshly built level, kept to restore on restart.
+// Only the columns stepWorld writes are held: geometry, scenery and the
+// platform and coin grids never change during play, so a restart leaves
+// them as they are.
+struct WorldSnapshot {
+    bool valid = false;
+    uint32_t seed = 0;              // Level build it belongs to
+    int stressEntities = 0;
+    std::vector<float> platformY;
+    std::vector<float> enemyX, enemyVelocity;
+    BitSet collected;
+    std::vector<Bird> birds;
+    Rng rng;
+};
+
+// Everything the simulation reads and writes. Nothing in here touches GLFW or
+// OpenGL, so a World can be stepped without a window (see runHeadless).
+struct World {
+    Player player;
+    PlatformStore platforms;
+    EnemyStore enemies;
+    CoinStore coins;
+    std::vector<Cloud> clouds;
+    std::vector<Bird> birds;
+    std::vector<Mountain> mountains;
+    std::vector<Tree> trees;
+    Flag levelFlag{LEVEL_END_X, -0.3f};
+    LevelView level = builtinLevel();  // What restarts rebuild from; a level file must stay open while in use
+    LevelStream *stream = nullptr;      // Endless mode: platforms, enemies, coins and scenery come from here
+
+    float cameraOffset = 0.0f;
+    float prevCameraOffset = 0.0f;  // Camera at the previous tick, for interpolation
+    float screenRightLimit = 0.5f;  // Right limit for camera to start following
+    float worldTime = 0.0f;         // Simulated seconds since the last restart
+    bool gameOver = false;
+    bool gameWin = false;
+    int score = 0;
+
+    // Broadphase: platforms and coins are inserted once per level, enemies
+    // are updated as they patrol
+    SpatialHash platformGrid, enemyGrid, coinGrid;
+    CandidateBoxes candidates;      // Narrow-phase scratch
+    uint32_t generation = 0;        // Bumped whenever the level is rebuilt
+    int stressEntities = 0;         // Extra platforms/enemies/coins spawned per kind
+    uint32_t seed = 1;              // Every restart reseeds rng with this
+    Rng rng;
+    WorldSnapshot initial;          // The level as built, for restarts
+};
+
+void applyInput(World &world, const InputState &input, float dt);
+
+// Insert the level's entities into the broadphase grids. Platform bounds
+// include their float range, so they never need updating.
+void buildBroadphase(World &world)
+{
+    const PlatformStore &platforms = world.platforms;
+    world.platformGrid.clear();
+    for (size_t i = 0; i < platforms.size(); i++)
+    {
+        CollisionBox bounds = centeredBox(platforms.x[i], platforms.initialY[i], platforms.width[i], platforms.height[i]);
+        bounds.minY -= PLATFORM_FLOAT_AMPLITUDE;
+        bounds.maxY += PLATFORM_FLOAT_AMPLITUDE;
+        world.platformGrid.insert((uint32_t)i, bounds);
+    }
+
+    const EnemyStore &enemies = world.enemies;
+    world.enemyGrid.clear();
+    for (size_t i = 0; i < enemies.size(); i++)
+        world.enemyGrid.insert((uint32_t)i, centeredBox(enemies.x[i], enemies.y[i], enemies.width[i], enemies.height[i]));
+
+    const CoinStore &coins = world.coins;
+    world.coinGrid.clear();
+    for (size_t i = 0; i < coins.size(); i++)
+        world.coinGrid.insert((uint32_t)i, centeredBox(coins.x[i], coins.y[i], coins.width[i], coins.height[i]));
+}
+
+// Populate the background from the level: clouds, birds, mountains, trees.
+// An endless level streams everything but the birds (see streamLevel).
+void initBackground(World &world)
+{
+    const LevelColumns &birds = world.level.sections[LEVEL_BIRDS];
+    world.birds.reserve(birds.count);
+    for (size_t i = 0; i < birds.count; i++)
+    {
+        world.birds.push_back(Bird(birds[BIRD_X][i], birds[BIRD_Y][i]));
+        world.birds.back().speed = birds[BIRD_SPEED][i];
+    }
+    if (world.stream)
+        return;
+
+    const LevelColumns &clouds = world.level.sections[LEVEL_CLOUDS];
+    world.clouds.reserve(clouds.count);
+    for (size_t i = 0; i < clouds.count; i++)
+    {
+        world.clouds.push_back(Cloud(clouds[CLOUD_X][i], clouds[CLOUD_Y][i], world.rng));
+        world.clouds.back().size = clouds[CLOUD_SIZE][i];
+    }
+
+    const LevelColumns &mountains = world.level.sections[LEVEL_MOUNTAINS];
+    world.mountains.reserve(mountains.count);
+    for (size_t i = 0; i < mountains.count; i++)
+        world.mountains.push_back(Mountain(mountains[MOUNTAIN_X][i], mountains[MOUNTAIN_Y][i],
+                                           mountains[MOUNTAIN_WIDTH][i], mountains[MOUNTAIN_HEIGHT][i],
+                                           glm::vec4(mountains[MOUNTAIN_R][i], mountains[MOUNTAIN_G][i],
+                                                     mountains[MOUNTAIN_B][i], mountains[MOUNTAIN_A][i])));
+
+    const LevelColumns &trees = world.level.sections[LEVEL_TREES];
+    world.trees.reserve(trees.count);
+    for (size_t i = 0; i < trees.count; i++)
+        world.trees.push_back(Tree(trees[TREE_X][i], trees[TREE_Y][i], trees[TREE_SIZE][i]));
+}
+
+// Endless mode: keep the stream's resident window around the camera and
+// rebuild the level from it whenever it moves. The window starts two chunks
+// behind the camera's and only moves once the camera is a whole chunk past
+// that, so running back and forth over a chunk edge does not rebuild every
+// tick. Enemy positions and collected coins are written back to their chunks
+// first; a chunk dropped from the pool forgets them.
+void streamLevel(World &world, bool restart)
+{
+    LevelStream &stream = *world.stream;
+    long long cameraChunk = chunkIndex(world.cameraOffset);
+    long long first = stream.first;
+    if (restart)
+        first = cameraChunk - 2;
+    else if (first < cameraChunk - 2)
+        first = cameraChunk - 2;
+    else if (first > cameraChunk - 1)
+        first = cameraChunk - 1;
+    else
+        return;
+
+    if (!restart)
+    {
+        size_t enemy = 0, coin = 0;
+        for (LevelChunk *chunk : stream.resident)
+        {
+            size_t enemies = chunk->counts[LEVEL_ENEMIES];
+            std::copy_n(world.enemies.x.begin() + enemy, enemies, chunk->column(LEVEL_ENEMIES, ENEMY_X));
+            std::copy_n(world.enemies.velocity.begin() + enemy, enemies, chunk->column(LEVEL_ENEMIES, ENEMY_VELOCITY));
+            enemy += enemies;
+            for (size_t i = 0; i < chunk->counts[LEVEL_COINS]; i++)
+                chunk->collected.assign(i, world.coins.collected.test(coin++));
+        }
+    }
+    stream.acquireWindow(first, restart, world.seed);
+
+    world.platforms.clear();
+    world.enemies.clear();
+    world.coins.clear();
+    world.clouds.clear();
+    world.mountains.clear();
+    world.trees.clear();
+    for (const LevelChunk *chunk : stream.resident)
+    {
+        world.platforms.append(chunk->section(LEVEL_PLATFORMS));
+        world.enemies.append(chunk->section(LEVEL_ENEMIES));
+        size_t coin = world.coins.size();
+        world.coins.append(chunk->section(LEVEL_COINS));
+        for (size_t i = 0; i < chunk->counts[LEVEL_COINS]; i++)
+            world.coins.collected.assign(coin + i, chunk->collected.test(i));
+
+        const LevelColumns clouds = chunk->section(LEVEL_CLOUDS);
+        for (size_t i = 0; i < clouds.count; i++)
+            world.clouds.push_back(Cloud(clouds[CLOUD_X][i], clouds[CLOUD_Y][i], clouds[CLOUD_SIZE][i],
+                                         chunk->cloudPhase[i]));
+        const LevelColumns mountains = chunk->section(LEVEL_MOUNTAINS);
+        for (size_t i = 0; i < mountains.count; i++)
+            world.mountains.push_back(Mountain(mountains[MOUNTAIN_X][i], mountains[MOUNTAIN_Y][i],
+                                               mountains[MOUNTAIN_WIDTH][i], mountains[MOUNTAIN_HEIGHT][i],
+                                               glm::vec4(mountains[MOUNTAIN_R][i], mountains[MOUNTAIN_G][i],
+                                                         mountains[MOUNTAIN_B][i], mountains[MOUNTAIN_A][i])));
+        const LevelColumns trees = chunk->section(LEVEL_TREES);
+        for (size_t i = 0; i < trees.count; i++)
+            world.trees.push_back(Tree(trees[TREE_X][i], trees[TREE_Y][i], trees[TREE_SIZE][i]));
+    }
+    buildBroadphase(world);
+    world.generation++;
+}
+
+// Populate the level: platforms, enemies and coins are copied a column at a time
+void initLevel(World &world)
+{
+    if (world.stream)
+    {
+        streamLevel(world, true);
+        return;
+    }
+
+    world.platforms.assign(world.level.sections[LEVEL_PLATFORMS]);
+    world.enemies.assign(world.level.sections[LEVEL_ENEMIES]);
+    world.coins.assign(world.level.sections[LEVEL_COINS]);
+    world.levelFlag.x = world.level.flagX;
+    world.levelFlag.y = world.level.flagY;
+
+    // Stress filler: rows of each entity kind well above the playfield, so
+    // they cost a full update and collision pass without changing the game
+    for (int i = 0; i < world.stressEntities; i++)
+    {
+        float x = -1.0f + (i % 1000) * 0.5f;
+        float y = 5.0f + (i / 1000) * 0.5f;
+        world.platforms.add(Platform(x, y, 0.4f, 0.1f));
+        world.enemies.add(Enemy(x, y + 0.2f));
+        world.coins.add(Coin(x, y + 0.3f));
+    }
+
+    buildBroadphase(world);
+}
+
+// Keep the state of the level just built for later restarts. An endless
+// level is rebuilt from its chunks instead.
+void captureSnapshot(World &world)
+{
+    WorldSnapshot &snapshot = world.initial;
+    snapshot.valid = !world.stream;
+    if (!snapshot.valid)
+        return;
+    snapshot.seed = world.seed;
+    snapshot.stressEntities = world.stressEntities;
+    snapshot.platformY = world.platforms.y;
+    snapshot.enemyX = world.enemies.x;
+    snapshot.enemyVelocity = world.enemies.velocity;
+    snapshot.collected = world.coins.collected;
+    snapshot.birds = world.birds;
+    snapshot.rng = world.rng;
+}
+
+// Copy the snapshot back over the level in place: the stores keep their
+// size, so nothing is allocated, and enemies are moved back in their grid
+// rather than the grids being rebuilt. False if the level has to be built.
+bool restoreSnapshot(World &world)
+{
+    const WorldSnapshot &snapshot = world.initial;
+    if (!snapshot.valid || world.stream || snapshot.seed != world.seed ||
+        snapshot.stressEntities != world.stressEntities)
+        return false;
+
+    std::copy(snapshot.platformY.begin(), snapshot.platformY.end(), world.platforms.y.begin());
+    EnemyStore &enemies = world.enemies;
+    std::copy(snapshot.enemyX.begin(), snapshot.enemyX.end(), enemies.x.begin());
+    std::copy(snapshot.enemyX.begin(), snapshot.enemyX.end(), enemies.prevX.begin());
+    std::copy(snapshot.enemyVelocity.begin(), snapshot.enemyVelocity.end(), enemies.velocity.begin());
+    for (size_t i = 0; i < enemies.size(); i++)
+        world.enemyGrid.update((uint32_t)i, centeredBox(enemies.x[i], enemies.y[i], enemies.width[i], enemies.height[i]));
+    std::copy(snapshot.collected.words.begin(), snapshot.collected.words.end(), world.coins.collected.words.begin());
+    std::copy(snapshot.birds.begin(), snapshot.birds.end(), world.birds.begin());
+    world.rng = snapshot.rng;
+    return true;
+}
+
+// Reset the player and the level. The first restart builds the level and
+// background; later ones restore the snapshot taken then.
+void restartWorld(World &world)
+{
+    // Reset player state
+    world.player.x = world.level.playerX;
+    world.player.y = world.level.playerY;
+    world.player.prevX = world.player.x;
+    world.player.prevY = world.player.y;
+    world.player.velocityY = 0.0f;
+    world.player.isJumping = false;
+    world.player.animTime = 0.0f;
+    world.player.animFrame = 0;
+    world.player.facingRight = true;
+
+    // Reset game state variables
+    world.cameraOffset = 0.0f;
+    world.prevCameraOffset = 0.0f;
+    world.worldTime = 0.0f;
+    world.gameOver = false;
+    world.gameWin = false;
+    world.score = 0;
+
+    // The level is unchanged, so the culler and the resident instances keep
+    // it too; generation is only bumped for a rebuild
+    if (restoreSnapshot(world))
+        return;
+    world.generation++;
+    world.rng.reseed(world.seed);
+
+    // Clear and reinitialize background elements
+    world.clouds.clear();
+    world.birds.clear();
+    world.mountains.clear();
+    world.trees.clear();
+    initBackground(world); // Repopulate background elements
+
+    // Clear and reinitialize game objects; after the background, which an
+    // endless level replaces
+    // initLevel will clear and repopulate platforms, enemies, coins
+    initLevel(world);    // This also resets levelFlag position
+    captureSnapshot(world);
+}
+
+// Apply one tick's worth of player input
+void applyInput(World &world, const InputState &input, float dt)
+{
+    // Player movement
+    if (input.right)
+    {
+        world.player.x += MOVEMENT_SPEED * dt;
+        world.player.facingRight = true;
+    }
+    if (input.left)
+    {
+        // Only allow moving left if not at the camera's left edge
+        if (world.player.x > world.cameraOffset - 0.8f)
+        {
+            world.player.x -= MOVEMENT_SPEED * dt;
+            world.player.facingRight = false;
+        }
+    }
+    if (input.jump && !world.player.isJumping)
+    {
+        world.player.velocityY = JUMP_FORCE;
+        world.player.isJumping = true;
+    }
+
+    // Restart game with R key
+    if (input.restart)
+    {
+        restartWorld(world); // Call the unified restart function
+    }
+}
+
+// Advance the world by one fixed simulation tick of dt seconds
+void stepWorld(World &world, const InputState &input, float dt)
+{
+    if (world.stream)
+        streamLevel(world, false);
+
+    // Remember where everything was for render interpolation
+    world.player.prevX = world.player.x;
+    world.player.prevY = world.player.y;
+    world.enemies.prevX = world.enemies.x;
+    for (Bird &bird : world.birds)
+        bird.prevX = bird.x;
+    world.prevCameraOffset = world.cameraOffset;
+    world.worldTime += dt;
+
+    // Update platform positions. They all float on one wave of worldTime, so
+    // it is evaluated once per tick; trees bob with it too, but only on the GPU
+    PlatformStore &platforms = world.platforms;
+    auto wave = sin(world.worldTime * PLATFORM_FLOAT_SPEED) * PLATFORM_FLOAT_AMPLITUDE;
+    for (size_t i = 0; i < platforms.size(); i++)
+        platforms.y[i] = platforms.initialY[i] + wave;
+
+    world.player.animTime += dt;
+    if (world.player.animTime > 0.2f)
+    {
+        world.player.animTime = 0.0f;
+        world.player.animFrame = (world.player.animFrame + 1) % 2;
+    }
+
+    applyInput(world, input, dt);
+
+    // Apply gravity
+    float previousBottom = world.player.y - world.player.height / 2;
+    world.player.velocityY -= GRAVITY * dt;
+    world.player.y += world.player.velocityY * dt;
+
+    // Check for platform collisions
+    bool onGround = false;
+    CandidateBoxes &candidates = world.candidates;
+    CollisionBox playerBox = centeredBox(world.player.x, world.player.y, world.player.width, world.player.height);
+    if (candidates.collide(world.platformGrid, playerBox, platforms.x.data(), platforms.y.data(),
+                           platforms.width.data(), platforms.height.data()))
+    {
+        for (size_t k = 0; k < candidates.ids.size(); k++)
+        {
+            if (!candidates.hit(k))
+                continue;
+            size_t i = candidates.ids[k];
+
+            // Check if player is landing on top of platform. Test where the feet were
+            // last tick, since a falling player can cover more than the tolerance per tick.
+            if (world.player.velocityY < 0 &&
+                previousBottom > (platforms.y[i] + platforms.height[i] / 2 - 0.01f))
+            {
+                world.player.y = platforms.y[i] + platforms.height[i] / 2 + world.player.height / 2;
+                world.player.velocityY = 0;
+                onGround = true;
+            }
+        }
+    }
+
+    if (onGround)
+    {
+        world.player.isJumping = false;
+    }
+
+    // Check if player fell off the screen
+    if (world.player.y < -1.0f && !world.gameOver && !world.gameWin) // Prevent re-triggering if already over
+    {
+        world.gameOver = true;
+    }
+
+    // Camera follows player
+    world.cameraOffset = world.player.x - world.screenRightLimit;
+    if (world.cameraOffset < 0)
+        world.cameraOffset = 0; // Don't let camera go past left edge
+
+    // Update enemies: patrol first, then test the moved boxes against the player
+    EnemyStore &enemies = world.enemies;
+    for (size_t i = 0; i < enemies.size(); i++)
+    {
+        enemies.x[i] += enemies.velocity[i] * dt;
+        if (enemies.x[i] > enemies.patrolRight[i] || enemies.x[i] < enemies.patrolLeft[i])
+        {
+            enemies.velocity[i] = -enemies.velocity[i];
+        }
+        world.enemyGrid.update((uint32_t)i, centeredBox(enemies.x[i], enemies.y[i], enemies.width[i], enemies.height[i]));
+    }
+
+    // Check for collision with any nearby enemy
+    playerBox = centeredBox(world.player.x, world.player.y, world.player.width, world.player.height);
+    if (candidates.collide(world.enemyGrid, playerBox, enemies.x.data(), enemies.y.data(),
+                           enemies.width.data(), enemies.height.data()))
+    {
+        if (!world.gameOver && !world.gameWin) // Prevent re-triggering
+            world.gameOver = true;
+    }
+
+    // Check coin collection
+    CoinStore &coins = world.coins;
+    if (candidates.collide(world.coinGrid, playerBox, coins.x.data(), coins.y.data(),
+                           coins.width.data(), coins.height.data()))
+    {
+        for (size_t k = 0; k < candidates.ids.size(); k++)
+        {
+            size_t i = candidates.ids[k];
+            if (candidates.hit(k) && !coins.collected.test(i))
+            {
+                coins.collected.set(i);
+                world.score += 100;
+            }
+        }
+    }
+
+    // Check if player reached the flag; an endless level has none
+    if (!world.stream && !world.gameWin && !world.gameOver && checkCollision( // Prevent re-triggering
+            world.player.x - world.player.width / 2, world.player.y - world.player.height / 2, world.player.width, world.player.height,
+            world.levelFlag.x - world.levelFlag.width / 2, world.levelFlag.y - world.levelFlag.height / 2, world.levelFlag.width, world.levelFlag.height))
+    {
+        
+        world.gameWin = true;
+    }
+
+    // Update bird logic (moved from drawing loop for better structure and dt usage)
+    for (Bird &bird : world.birds) {
+        // Bird speed is 0.03f in constructor, assume units/sec
+        float timeBasedFluctuation = (0.8f + sin(world.worldTime * 0.5f) * 0.2f); // Simulated time keeps the sine wave tick-rate independent
+        float effectiveSpeed = bird.speed * timeBasedFluctuation;
+
+        if (bird.movingRight) {
+            bird.x += effectiveSpeed * dt;
+            if (bird.x > 2.5f + world.cameraOffset) // Adjust patrol limits relative to camera if they are world-space
+                bird.movingRight = false;
+        } else {
+            bird.x -= effectiveSpeed * dt;
+            if (bird.x < -1.5f + world.cameraOffset)
+                bird.movingRight = true;
+        }
+    }
+
+    // Cloud bouncing and the birds' vertical sine flight are cosmetic and
+    // evaluated by the instanced shader from worldTime
+
+    // Bird movement update (replace existing bird movement code)
+    const float BIRD_HORIZONTAL_SPEED = 0.2f;
+
+    for (Bird &bird : world.birds) {
+        // Horizontal movement
+        if (bird.movingRight) {
+            bird.x += BIRD_HORIZONTAL_SPEED * dt;
+            if (bird.x > 2.5f + world.cameraOffset) {
+                bird.movingRight = false;
+            }
+        } else {
+            bird.x -= BIRD_HORIZONTAL_SPEED * dt;
+            if (bird.x < -1.5f + world.cameraOffset) {
+                bird.movingRight = true;
+            }
+        }
+    }
+}
+
+// Scripted input for headless runs: hold right and tap jump for 0.05 s every
+// half second of the round, from 0.22 s in. A jump lasts about 0.77 s, so
+// every other tap lands and the player hops once a second, which carries it
+// across the built-in level's gaps and over its enemies to the flag at any
+// tick rate. Other levels, endless ones included, may still end in deaths.
+InputState headlessInput(const World &world)
+{
+    const float period = 0.5f, offset = 0.22f, hold = 0.05f;
+    InputState input;
+    input.right = true;
+    input.jump = fmod(world.worldTime + period - offset, period) < hold;
+    return input;
+}
+
+// Step the simulation for a fixed number of ticks with no window or GL
+// context and report the raw tick throughput. Finished rounds restart
+// immediately, like the windowed loop does.
+void runHeadless(long long ticks, float tickRate, uint32_t seed, int stressEntities, const LevelView &level,
+                 LevelStream *stream)
+{
+    World world;
+    world.level = level;
+    world.stream = stream;
+    world.seed = seed;
+    world.stressEntities = stressEntities;
+    restartWorld(world);
+    const float dt = 1.0f / tickRate;
+    long long wins = 0, losses = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (long long tick = 0; tick < ticks; tick++)
+    {
+        if (world.gameOver || world.gameWin)
+        {
+            if (world.gameWin)
+                wins++;
+            else
+                losses++;
+            restartWorld(world);
+        }
+        stepWorld(world, headlessInput(world), dt);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "headless: " << ticks << " ticks at " << tickRate << " Hz in " << seconds << " s ("
+              << (long long)(seconds > 0.0 ? ticks / seconds : 0.0) << " ticks/s)\n"
+              << "headless: " << wins << " wins, " << losses << " losses, final score " << world.score
+              << ", player x " << world.player.x << "\n";
+
+    // Broadphase work per query; flat as --entities grows if the grid is doing its job
+    const SpatialHash *grids[] = {&world.platformGrid, &world.enemyGrid, &world.coinGrid};
+    const char *names[] = {"platforms", "enemies", "coins"};
+    size_t sizes[] = {world.platforms.size(), world.enemies.size(), world.coins.size()};
+    for (int g = 0; g < 3; g++)
+    {
+        const BroadphaseStats &stats = grids[g]->stats;
+        double queries = stats.queries > 0 ? (double)stats.queries : 1.0;
+        std::cout << "broadphase: " << names[g] << " (" << sizes[g] << "): "
+                  << stats.cellsVisited / queries << " cells, "
+                  << stats.candidates / queries << " candidates per query, "
+                  << stats.moves << " cell moves\n";
+    }
+
+    if (stream)
+    {
+        StreamStats streamStats = stream->snapshot();
+        std::cout << "stream: " << streamStats.generated << " chunks generated, "
+                  << (streamStats.generated > 0 ? streamStats.generateMs / streamStats.generated : 0.0)
+                  << " ms average, " << streamStats.maxGenerateMs << " ms max; " << streamStats.resident
+                  << " resident, " << streamStats.free << " free of " << LevelStream::POOL << "; "
+                  << streamStats.moves << " window moves, " << streamStats.stalls << " stalls\n";
+    }
+}
@@ -0,0 +1,241 @@
+#pragma once
+#include "Simulation.h"
+#include "Replay.h"
+#include "Rewind.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+// Function to draw text on screen (simulated with console output)
+void updateHUD(const World &world)
+{
+    // Clear previous line
+    std::cout << "\r                                                 ";
+    // Display the score and coins collected
+    size_t coinsCollected = world.coins.collected.popcount();
+    std::cout << "\rScore: " << std::setw(6) << std::setfill('0') << world.score
+              << " | Coins: " << coinsCollected << "/" << world.coins.size();
+    std::cout.flush();
+}
+
+// Print the win/loss banner before the automatic restart
+void announceResult(const World &world)
+{
+    if (world.gameWin) {
+        std::cout << std::endl << std::endl;
+        std::cout << "=====================================" << std::endl;
+        std::cout << "   CONGRATULATIONS! YOU WON!" << std::endl;
+        std::cout << "   Final Score: " << world.score << std::endl;
+        std::cout << "=====================================" << std::endl;
+    } else { // gameOver
+        std::cout << std::endl << std::endl;
+        std::cout << "=====================================" << std::endl;
+        std::cout << "   GAME OVER!" << std::endl;
+        std::cout << "   Final Score: " << world.score << std::endl;
+        std::cout << "=====================================" << std::endl;
+    }
+}
+
+// The interactive game's work per frame, on whichever thread steps the world:
+// rewind while held, restart after a result, step, record for rewind and
+// --record, then keep the score line current
+struct PlaySession {
+    RewindBuffer rewindBuffer;
+    InputLog inputLog;
+    bool recording = false;
+    int shownScore = -1;            // What the score line shows; -1 forces a redraw
+    size_t shownCoins = 0;
+
+    void advance(World &world, const InputState &input, bool rewinding, int ticks, float tickSeconds) {
+        for (int i = 0; i < ticks; i++) {
+            // While rewinding, each tick steps back one recorded tick instead
+            if (rewinding) {
+                rewindBuffer.rewind(world);
+                continue;
+            }
+
+            // Handle game state transitions (win/loss) and auto-restart
+            if (world.gameOver || world.gameWin) {
+                announceResult(world);
+                restartWorld(world); // Resets game state, including gameOver and gameWin flags
+                shownScore = -1;
+            }
+            stepWorld(world, input, tickSeconds);
+            rewindBuffer.record(world);
+            if (recording) {
+                inputLog.record(input);
+                inputLog.recordState(world);
+            }
+        }
+        if (input.restart && ticks > 0) {
+            std::cout << "\nGame manually restarted by R key.\n"; // Optional: feedback
+            shownScore = -1;
+        }
+        showHUD(world);
+    }
+
+    // Rewrite the score line only when it changed
+    void showHUD(const World &world) {
+        size_t coins = world.coins.collected.popcount();
+        if (world.score == shownScore && coins == shownCoins)
+            return;
+        updateHUD(world);
+        shownScore = world.score;
+        shownCoins = coins;
+    }
+};
+
+// Single-writer, single-reader triple buffer. The writer fills its back slot
+// and swaps it with the middle one; the reader swaps its front slot for the
+// middle one when that holds something newer. Each side only ever touches its
+// own slot and one atomic index, so neither waits for the other, and a slow
+// reader just skips the frames it missed.
+template <typename T>
+struct TripleBuffer {
+    static const uint32_t FRESH = 4;    // Set in middle when it was published since the reader last took it
+
+    T slots[3];
+    std::atomic<uint32_t> middle{1};
+    uint32_t back = 0;
+    uint32_t front = 2;
+
+    T &writeSlot() { return slots[back]; }
+    const T &readSlot() const { return slots[front]; }
+
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+    }
+
+    // Take the newest published slot; false, keeping the current one, if there is none
+    bool acquire() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH))
+            return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & ~FRESH;
+        return true;
+    }
+};
+
+// Copy what drawing reads from one World into another. The level content is
+// copied only when the generation differs; otherwise just what ticks change.
+void copyRenderState(World &to, const World &from)
+{
+    if (to.generation != from.generation) {
+        to.platforms = from.platforms;
+        to.enemies = from.enemies;
+        to.coins = from.coins;
+        to.clouds = from.clouds;
+        to.mountains = from.mountains;
+        to.trees = from.trees;
+        to.levelFlag = from.levelFlag;
+        to.stream = from.stream;
+        to.generation = from.generation;
+    } else {
+        to.enemies.x = from.enemies.x;
+        to.enemies.prevX = from.enemies.prevX;
+        to.coins.collected = from.coins.collected;
+    }
+    to.player = from.player;
+    to.birds = from.birds;
+    to.cameraOffset = from.cameraOffset;
+    to.prevCameraOffset = from.prevCameraOffset;
+    to.worldTime = from.worldTime;
+    to.score = from.score;
+    to.gameOver = from.gameOver;
+    to.gameWin = from.gameWin;
+}
+
+// A world as of one tick, published for the renderer and not written again
+// until the renderer has moved on to a newer one
+struct FrameSnapshot {
+    World world;                    // Only the parts copyRenderState fills
+    long long tick = 0;
+    double tickTime = 0.0;          // Simulation clock seconds at which this tick became current
+    RewindStats rewind;
+};
+
+// Steps a World on its own thread at the fixed tick rate and publishes each
+// batch of ticks as a FrameSnapshot. The main thread hands over input as one
+// atomic word and takes the newest snapshot when it starts a frame, so a long
+// tick overlaps rendering instead of delaying it, and a slow frame never holds
+// up the simulation.
+struct SimulationThread {
+    static const uint32_t INPUT_REWIND = 1 << 8;   // Above the InputBits a recording stores
+
+    World world;                    // Owned by the thread between start() and stop()
+    PlaySession session;
+    TripleBuffer<FrameSnapshot> frames;
+    std::atomic<uint32_t> input{0};
+    std::atomic<bool> stopping{false};
+    std::thread thread;
+    FixedTimestep timestep{SIM_TICK_RATE};
+    long long ticks = 0;
+    std::chrono::steady_clock::time_point epoch;
+
+    // Publish the world as it stands, then start stepping it
+    void start(float tickRate) {
+        timestep = FixedTimestep(tickRate);
+        epoch = std::chrono::steady_clock::now();
+        publish(0.0);
+        stopping = false;
+        thread = std::thread(&SimulationThread::run, this);
+    }
+
+    void stop() {
+        if (!thread.joinable())
+            return;
+        stopping = true;
+        thread.join();
+    }
+
+    ~SimulationThread() {
+        stop();
+    }
+
+    // Seconds on the simulation clock
+    double now() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    void setInput(const InputState &state, bool rewinding) {
+        input.store(encodeInput(state) | (rewinding ? INPUT_REWIND : 0), std::memory_order_relaxed);
+    }
+
+    // How far the renderer is from frame's tick towards the next one (0..1)
+    float alpha(const FrameSnapshot &frame) const {
+        return (float)std::min(1.0, std::max(0.0, (now() - frame.tickTime) / timestep.tickSeconds));
+    }
+
+    void run() {
+        double last = now();
+        while (!stopping.load(std::memory_order_relaxed)) {
+            double current = now();
+            int due = timestep.advance((float)(current - last));
+            last = current;
+            if (due > 0) {
+                uint32_t bits = input.load(std::memory_order_relaxed);
+                session.advance(world, decodeInput((uint8_t)bits), (bits & INPUT_REWIND) != 0, due,
+                                timestep.tickSeconds);
+                ticks += due;
+                publish(current - timestep.accumulator);
+            }
+            // Sleep until the next tick is due
+            float wait = timestep.tickSeconds - timestep.accumulator;
+            if (wait > 0.0f)
+                std::this_thread::sleep_for(std::chrono::duration<float>(wait));
+        }
+    }
+
+    void publish(double tickTime) {
+        FrameSnapshot &frame = frames.writeSlot();
+        copyRenderState(frame.world, world);
+        frame.tick = ticks;
+        frame.tickTime = tickTime;
+        if (session.rewindBuffer.enabled())
+            frame.rewind = session.rewindBuffer.stats();
+        frames.publish();
+    }
+};
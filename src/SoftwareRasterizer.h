@@ -0,0 +1,452 @@
+#pragma once
+#include "MeshAtlas.h"
+#include "RenderQueue.h"
+#include "Renderer.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Edge functions are evaluated four pixels at a time with SSE2 when GLM's
+// architecture detection reports it (see Collision.h)
+#if (GLM_ARCH & GLM_ARCH_SSE2_BIT)
+#include <emmintrin.h>
+#define RASTER_SIMD_WIDTH 4
+#define RASTER_SIMD_NAME "sse2"
+#else
+#define RASTER_SIMD_WIDTH 1
+#define RASTER_SIMD_NAME "scalar"
+#endif
+
+// Per-frame counters of the software backend
+struct SoftwareStats {
+    int triangles = 0;
+    int sdfQuads = 0;
+    int binned = 0;             // Primitive references across all tile bins
+    double setupMs = 0.0;       // Transforming the queue's batches into window-space primitives
+    double binMs = 0.0;
+    double rasterMs = 0.0;
+};
+
+// One primitive in window coordinates (pixels, y up, like gl_FragCoord)
+struct RasterPrimitive {
+    glm::vec2 v[3];             // Triangle, counter-clockwise; unused for SDF quads
+    int minX, minY, maxX, maxY; // Pixels whose centers may be covered, clipped to the target
+    glm::vec4 color;
+    uint32_t packed;            // color as RGBA8
+    int shape;                  // -1 = flat triangle, else the SDF shape (see sdfShape)
+    glm::vec2 origin;           // SDF: window position of the shape's origin
+    glm::vec2 scale;            // SDF: pixels per shape unit
+};
+
+inline uint8_t unorm8(float c) {
+    return (uint8_t)(std::min(std::max(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+inline uint32_t packRGBA8(const glm::vec4 &c) {
+    return (uint32_t)unorm8(c.r) | ((uint32_t)unorm8(c.g) << 8) | ((uint32_t)unorm8(c.b) << 16) |
+           ((uint32_t)unorm8(c.a) << 24);
+}
+
+// Signed distances of sdfFragmentShaderSource, in shape units
+inline float sdfCircle(glm::vec2 p, glm::vec2 center, float radius) {
+    return glm::length(p - center) - radius;
+}
+
+inline float sdfTriangle(glm::vec2 p, glm::vec2 a, glm::vec2 b, glm::vec2 c) {
+    glm::vec2 e0 = b - a, e1 = c - b, e2 = a - c;
+    glm::vec2 v0 = p - a, v1 = p - b, v2 = p - c;
+    glm::vec2 q0 = v0 - e0 * glm::clamp(glm::dot(v0, e0) / glm::dot(e0, e0), 0.0f, 1.0f);
+    glm::vec2 q1 = v1 - e1 * glm::clamp(glm::dot(v1, e1) / glm::dot(e1, e1), 0.0f, 1.0f);
+    glm::vec2 q2 = v2 - e2 * glm::clamp(glm::dot(v2, e2) / glm::dot(e2, e2), 0.0f, 1.0f);
+    float s = glm::sign(e0.x * e2.y - e0.y * e2.x);
+    glm::vec2 d = glm::min(glm::min(glm::vec2(glm::dot(q0, q0), s * (v0.x * e0.y - v0.y * e0.x)),
+                                    glm::vec2(glm::dot(q1, q1), s * (v1.x * e1.y - v1.y * e1.x))),
+                           glm::vec2(glm::dot(q2, q2), s * (v2.x * e2.y - v2.y * e2.x)));
+    return -std::sqrt(d.x) * glm::sign(d.y);
+}
+
+inline float sdfDistance(int shape, glm::vec2 p, float time) {
+    if (shape == 0)
+        return sdfCircle(p, glm::vec2(0.0f), 1.0f);
+    if (shape == 1)
+        return std::min(std::min(sdfCircle(p, glm::vec2(0.0f), 1.0f), sdfCircle(p, glm::vec2(0.8f, 0.0f), 0.8f)),
+                        std::min(sdfCircle(p, glm::vec2(-0.8f, 0.0f), 0.9f), sdfCircle(p, glm::vec2(0.0f, 0.3f), 0.7f)));
+    float turn = time * 0.2f;
+    float angle = turn + std::round((std::atan2(p.y, p.x) - turn) / 0.7853982f) * 0.7853982f;
+    float c = std::cos(angle), s = std::sin(angle);
+    glm::vec2 q = p - 0.2f * glm::vec2(c, s);
+    q = glm::vec2(c * q.x - s * q.y, s * q.x + c * q.y);
+    return sdfTriangle(q, glm::vec2(-0.01f, -0.025f), glm::vec2(0.01f, -0.025f), glm::vec2(0.0f, 0.025f));
+}
+
+// Fixed pool of worker threads that run one job at a time, the calling
+// thread taking part as worker 0
+struct RasterWorkers {
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    std::function<void(int)> job;
+    uint64_t generation = 0;
+    int pending = 0;
+    bool quit = false;
+
+    void start(int count) {
+        for (int i = 1; i < count; i++)
+            threads.emplace_back(&RasterWorkers::loop, this, i);
+    }
+
+    int count() const {
+        return (int)threads.size() + 1;
+    }
+
+    // Run f(worker) on every worker; returns when all have finished
+    void run(const std::function<void(int)> &f) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = f;
+            pending = (int)threads.size();
+            generation++;
+        }
+        wake.notify_all();
+        f(0);
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pending == 0; });
+    }
+
+    void loop(int worker) {
+        uint64_t seen = 0;
+        for (;;) {
+            std::function<void(int)> f;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return quit || generation != seen; });
+                if (quit)
+                    return;
+                seen = generation;
+                f = job;
+            }
+            f(worker);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0)
+                done.notify_one();
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads)
+            thread.join();
+        threads.clear();
+    }
+};
+
+// CPU backend of the RenderQueue for machines without a GPU: executes the
+// same built batches as SpriteBatch (instances, static slices, SDF quads
+// and stream triangles) into an RGBA8 buffer, bottom row first like
+// glReadPixels. It follows the GL pipeline it replaces: the instanced
+// vertex shader's animation, pixel-center sampling with a top-left fill
+// rule, the SDF coverage and the blend function set up in main().
+//
+// Each frame the batches become window-space primitives, every worker bins
+// its share of them into per-tile lists, and workers then take whole tiles
+// and draw their lists in order, so no two threads touch the same pixel and
+// the draw order within every pixel is the queue's.
+struct SoftwareRasterizer {
+    static const int TILE = 32;     // Tile size, in pixels
+
+    const MeshAtlas *atlas = nullptr;
+    int width = 0, height = 0;
+    int tilesX = 0, tilesY = 0;
+    std::vector<uint32_t> pixels;                   // RGBA8, bottom row first
+    std::vector<RasterPrimitive> primitives;
+    std::vector<std::vector<uint32_t>> bins;        // [worker * tileCount + tile], primitive indices
+    std::atomic<int> nextTile{0};
+    glm::vec2 sdfHalf[MESH_COUNT];                  // Half extents of the SDF quads, in shape units
+    float sdfTime = 0.0f;                           // Animation time of the frame, for the sun's rays
+    RasterWorkers workers;
+    SoftwareStats stats;
+
+    // threads <= 0 uses one per hardware thread
+    void init(const MeshAtlas &meshAtlas, int targetWidth, int targetHeight, int threads) {
+        atlas = &meshAtlas;
+        width = targetWidth;
+        height = targetHeight;
+        tilesX = (width + TILE - 1) / TILE;
+        tilesY = (height + TILE - 1) / TILE;
+        pixels.assign((size_t)width * height, 0);
+        for (int mesh = 0; mesh < MESH_COUNT; mesh++) {
+            const MeshRange &range = atlas->range((MeshId)mesh);
+            sdfHalf[mesh] = glm::vec2(0.0f);
+            for (uint32_t v = range.firstVertex; v < range.firstVertex + range.vertexCount; v++)
+                sdfHalf[mesh] = glm::max(sdfHalf[mesh], glm::abs(atlas->vertices[v]));
+        }
+        if (threads <= 0)
+            threads = std::max(1, (int)std::thread::hardware_concurrency());
+        workers.start(threads);
+        bins.resize((size_t)workers.count() * tilesX * tilesY);
+    }
+
+    // Execute a built queue; resident slices come from scene
+    void render(const RenderQueue &queue, const StaticScene &scene, float cameraOffset, float time,
+                const glm::vec4 &clearColor) {
+        auto t0 = std::chrono::steady_clock::now();
+        stats = SoftwareStats();
+        sdfTime = time;
+        setup(queue, scene, cameraOffset, time);
+        auto t1 = std::chrono::steady_clock::now();
+
+        const int tileCount = tilesX * tilesY;
+        const int workerCount = workers.count();
+        workers.run([&](int worker) {
+            size_t first = primitives.size() * worker / workerCount;
+            size_t last = primitives.size() * (worker + 1) / workerCount;
+            std::vector<uint32_t> *own = &bins[(size_t)worker * tileCount];
+            for (int tile = 0; tile < tileCount; tile++)
+                own[tile].clear();
+            for (size_t i = first; i < last; i++) {
+                const RasterPrimitive &p = primitives[i];
+                for (int ty = p.minY / TILE; ty <= p.maxY / TILE; ty++)
+                    for (int tx = p.minX / TILE; tx <= p.maxX / TILE; tx++)
+                        own[ty * tilesX + tx].push_back((uint32_t)i);
+            }
+        });
+        for (const std::vector<uint32_t> &bin : bins)
+            stats.binned += (int)bin.size();
+        auto t2 = std::chrono::steady_clock::now();
+
+        const uint32_t clear = packRGBA8(clearColor);
+        nextTile = 0;
+        workers.run([&](int) {
+            for (int tile = nextTile++; tile < tileCount; tile = nextTile++)
+                drawTile(tile, clear);
+        });
+        auto t3 = std::chrono::steady_clock::now();
+
+        stats.setupMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        stats.binMs = std::chrono::duration<double, std::milli>(t2 - t1).count();
+        stats.rasterMs = std::chrono::duration<double, std::milli>(t3 - t2).count();
+    }
+
+    // World space to window coordinates, as worldToClip and the viewport do,
+    // snapped to the 1/256 pixel grid GL rasterizers use
+    glm::vec2 toWindow(DrawLayer layer, glm::vec2 p, float cameraOffset) const {
+        p.x -= cameraOffset * layerParallax[layer];
+        glm::vec2 w((p.x + 1.0f) * 0.5f * width, (p.y + 1.0f) * 0.5f * height);
+        return glm::round(w * 256.0f) / 256.0f;
+    }
+
+    void setup(const RenderQueue &queue, const StaticScene &scene, float cameraOffset, float time) {
+        primitives.clear();
+        for (const RenderBatch &batch : queue.batches) {
+            if (batch.shader == SPRITE_SHADER_STREAM) {
+                for (size_t i = batch.first; i + 2 < batch.first + batch.count; i += 3) {
+                    const SpriteVertex &a = queue.streamVertices[queue.streamIndices[i]];
+                    const SpriteVertex &b = queue.streamVertices[queue.streamIndices[i + 1]];
+                    const SpriteVertex &c = queue.streamVertices[queue.streamIndices[i + 2]];
+                    addTriangle(toWindow(batch.layer, a.position, cameraOffset),
+                                toWindow(batch.layer, b.position, cameraOffset),
+                                toWindow(batch.layer, c.position, cameraOffset), a.color);
+                }
+                continue;
+            }
+            const bool resident = batch.shader == SPRITE_SHADER_STATIC || batch.shader == SPRITE_SHADER_SDF_STATIC;
+            const SpriteInstance *instances = resident ? scene.buckets[batch.layer][batch.mesh].data()
+                                                       : queue.sortedInstances.data();
+            for (size_t i = batch.first; i < batch.first + batch.count; i++)
+                addInstance(batch.layer, batch.mesh, instances[i], cameraOffset, time);
+        }
+    }
+
+    // The instanced vertex shader's placement and animation
+    void addInstance(DrawLayer layer, MeshId mesh, const SpriteInstance &instance, float cameraOffset, float time) {
+        const glm::vec4 &anim = instance.anim;
+        float wave = std::sin(time * anim.z + anim.x);
+        glm::vec2 center(instance.x, instance.y + anim.y * wave);
+        glm::vec2 size = glm::vec2(instance.width, instance.height) * (1.0f + anim.w * wave);
+        if (size.x == 0.0f || size.y == 0.0f)
+            return;
+
+        if (isSdfMesh(mesh)) {
+            RasterPrimitive p;
+            glm::vec2 lo = toWindow(layer, center - sdfHalf[mesh] * glm::abs(size), cameraOffset);
+            glm::vec2 hi = toWindow(layer, center + sdfHalf[mesh] * glm::abs(size), cameraOffset);
+            p.origin = toWindow(layer, center, cameraOffset);
+            p.scale = size * glm::vec2(0.5f * width, 0.5f * height);
+            p.shape = sdfShape(mesh);
+            p.color = instance.color;
+            p.packed = packRGBA8(instance.color);
+            // Pixel centers in [lo, hi)
+            p.minX = std::max(0, (int)std::ceil(lo.x - 0.5f));
+            p.minY = std::max(0, (int)std::ceil(lo.y - 0.5f));
+            p.maxX = std::min(width - 1, (int)std::ceil(hi.x - 0.5f) - 1);
+            p.maxY = std::min(height - 1, (int)std::ceil(hi.y - 0.5f) - 1);
+            if (p.minX <= p.maxX && p.minY <= p.maxY) {
+                primitives.push_back(p);
+                stats.sdfQuads++;
+            }
+            return;
+        }
+
+        const MeshRange &range = atlas->range(mesh);
+        for (uint32_t i = range.firstIndex; i + 2 < range.firstIndex + range.indexCount; i += 3) {
+            glm::vec2 v[3];
+            for (int k = 0; k < 3; k++)
+                v[k] = toWindow(layer, center + atlas->vertices[atlas->indices[i + k]] * size, cameraOffset);
+            addTriangle(v[0], v[1], v[2], instance.color);
+        }
+    }
+
+    void addTriangle(glm::vec2 a, glm::vec2 b, glm::vec2 c, const glm::vec4 &color) {
+        float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        if (area == 0.0f)
+            return;
+        if (area < 0.0f)
+            std::swap(b, c);
+        RasterPrimitive p;
+        p.v[0] = a;
+        p.v[1] = b;
+        p.v[2] = c;
+        glm::vec2 lo = glm::min(a, glm::min(b, c)), hi = glm::max(a, glm::max(b, c));
+        p.minX = std::max(0, (int)std::floor(lo.x - 0.5f));
+        p.minY = std::max(0, (int)std::floor(lo.y - 0.5f));
+        p.maxX = std::min(width - 1, (int)std::ceil(hi.x - 0.5f));
+        p.maxY = std::min(height - 1, (int)std::ceil(hi.y - 0.5f));
+        if (p.minX > p.maxX || p.minY > p.maxY)
+            return;
+        p.color = color;
+        p.packed = packRGBA8(color);
+        p.shape = -1;
+        primitives.push_back(p);
+        stats.triangles++;
+    }
+
+    void drawTile(int tile, uint32_t clear) {
+        const int x0 = (tile % tilesX) * TILE, y0 = (tile / tilesX) * TILE;
+        const int x1 = std::min(x0 + TILE, width) - 1, y1 = std::min(y0 + TILE, height) - 1;
+        for (int y = y0; y <= y1; y++)
+            std::fill(&pixels[(size_t)y * width + x0], &pixels[(size_t)y * width + x1] + 1, clear);
+
+        const int tileCount = tilesX * tilesY;
+        for (int worker = 0; worker < workers.count(); worker++) {
+            for (uint32_t index : bins[(size_t)worker * tileCount + tile]) {
+                const RasterPrimitive &p = primitives[index];
+                int minX = std::max(p.minX, x0), maxX = std::min(p.maxX, x1);
+                int minY = std::max(p.minY, y0), maxY = std::min(p.maxY, y1);
+                if (p.shape < 0)
+                    drawTriangle(p, minX, minY, maxX, maxY);
+                else
+                    drawSdf(p, minX, minY, maxX, maxY);
+            }
+        }
+    }
+
+    // src over dst with glBlendFuncSeparate(SRC_ALPHA, ONE_MINUS_SRC_ALPHA, ONE, ONE_MINUS_SRC_ALPHA)
+    static uint32_t blend(uint32_t dst, const glm::vec4 &src, float alpha) {
+        float keep = 1.0f - alpha;
+        float r = src.r * alpha + (dst & 0xff) / 255.0f * keep;
+        float g = src.g * alpha + ((dst >> 8) & 0xff) / 255.0f * keep;
+        float b = src.b * alpha + ((dst >> 16) & 0xff) / 255.0f * keep;
+        float a = alpha + (dst >> 24) / 255.0f * keep;
+        return packRGBA8(glm::vec4(r, g, b, a));
+    }
+
+    // Edge functions of the counter-clockwise triangle at pixel centers. An
+    // edge's own pixels belong to it only if it is a top or left edge, so
+    // triangles sharing an edge never both cover a pixel.
+    void drawTriangle(const RasterPrimitive &p, int minX, int minY, int maxX, int maxY) {
+        float stepX[3], stepY[3], originX[3], originY[3];
+        bool inclusive[3];
+        for (int e = 0; e < 3; e++) {
+            glm::vec2 a = p.v[e], b = p.v[(e + 1) % 3];
+            stepX[e] = a.y - b.y;
+            stepY[e] = b.x - a.x;
+            originX[e] = a.x;
+            originY[e] = a.y;
+            inclusive[e] = (a.y == b.y && b.x < a.x) || b.y < a.y;
+        }
+        const bool opaque = p.color.a >= 1.0f;
+
+        for (int y = minY; y <= maxY; y++) {
+            uint32_t *row = &pixels[(size_t)y * width];
+            float rowEdge[3];
+            for (int e = 0; e < 3; e++)
+                rowEdge[e] = stepY[e] * (y + 0.5f - originY[e]);
+            int x = minX;
+#if RASTER_SIMD_WIDTH == 4
+            const __m128 lanes = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+            const __m128i color = _mm_set1_epi32((int)p.packed);
+            for (; x + 3 <= maxX; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps((float)x), lanes);
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (int e = 0; e < 3; e++) {
+                    __m128 edge = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(stepX[e]), _mm_sub_ps(px, _mm_set1_ps(originX[e]))),
+                                             _mm_set1_ps(rowEdge[e]));
+                    __m128 test = inclusive[e] ? _mm_cmpge_ps(edge, _mm_setzero_ps())
+                                               : _mm_cmpgt_ps(edge, _mm_setzero_ps());
+                    inside = _mm_and_ps(inside, test);
+                }
+                int bits = _mm_movemask_ps(inside);
+                if (!bits)
+                    continue;
+                if (opaque) {
+                    __m128i mask = _mm_castps_si128(inside);
+                    __m128i dst = _mm_loadu_si128((const __m128i *)(row + x));
+                    _mm_storeu_si128((__m128i *)(row + x),
+                                     _mm_or_si128(_mm_and_si128(mask, color), _mm_andnot_si128(mask, dst)));
+                } else {
+                    for (int lane = 0; lane < 4; lane++)
+                        if (bits & (1 << lane))
+                            row[x + lane] = blend(row[x + lane], p.color, p.color.a);
+                }
+            }
+#endif
+            for (; x <= maxX; x++) {
+                bool inside = true;
+                for (int e = 0; e < 3 && inside; e++) {
+                    float edge = stepX[e] * (x + 0.5f - originX[e]) + rowEdge[e];
+                    inside = inclusive[e] ? edge >= 0.0f : edge > 0.0f;
+                }
+                if (inside)
+                    row[x] = opaque ? p.packed : blend(row[x], p.color, p.color.a);
+            }
+        }
+    }
+
+    // The SDF fragment shader: coverage from the distance over its screen
+    // derivative, taken here as forward differences one pixel right and up
+    void drawSdf(const RasterPrimitive &p, int minX, int minY, int maxX, int maxY) {
+        for (int y = minY; y <= maxY; y++) {
+            uint32_t *row = &pixels[(size_t)y * width];
+            for (int x = minX; x <= maxX; x++) {
+                glm::vec2 local = (glm::vec2(x + 0.5f, y + 0.5f) - p.origin) / p.scale;
+                float d = sdfDistance(p.shape, local, sdfTime);
+                // Derivatives across the pixel's 2x2 quad, as GPUs take them
+                glm::vec2 quad = (glm::vec2((x & ~1) + 0.5f, (y & ~1) + 0.5f) - p.origin) / p.scale;
+                float d00 = sdfDistance(p.shape, quad, sdfTime);
+                float dx = sdfDistance(p.shape, quad + glm::vec2(1.0f / p.scale.x, 0.0f), sdfTime) - d00;
+                float dy = sdfDistance(p.shape, quad + glm::vec2(0.0f, 1.0f / p.scale.y), sdfTime) - d00;
+                float fw = std::abs(dx) + std::abs(dy);
+                float coverage = fw > 0.0f ? glm::clamp(0.5f - d / fw, 0.0f, 1.0f) : (d < 0.0f ? 1.0f : 0.0f);
+                if (coverage <= 0.0f)
+                    continue;
+                row[x] = blend(row[x], p.color, p.color.a * coverage);
+            }
+        }
+    }
+
+    void destroy() {
+        workers.stop();
+    }
+};
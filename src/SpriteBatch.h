@@ -0,0 +1,150 @@
+#pragma once
+#include "glad.h"
+#include "GLState.h"
+#include "MeshAtlas.h"
+#include "Renderer.h"
+#include "RenderQueue.h"
+#include "Utils.h"
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per-frame batching counters
+struct SpriteBatchStats {
+    int intents = 0;        // Shapes submitted this frame
+    int batches = 0;        // Draw calls issued
+    int instances = 0;
+    int staticInstances = 0;    // Drawn from the resident level buffer
+    int vertices = 0;       // Vertices expanded into the stream buffer
+    int indices = 0;
+    size_t uploadedBytes = 0;   // Instance, stream and frame-constant bytes sent this frame
+};
+
+// GL backend of the RenderQueue: the frame's draw intents are queued into
+// queue, and the built queue is executed with a handful of draws sorted by
+// layer, shader and mesh. Instances are drawn from one instance buffer,
+// stream triangles from one streaming vertex/index buffer, and resident
+// instances from instances' static buffer, uploaded from a StaticScene.
+// The camera, parallax and animation time come from the FrameConstants
+// uniform block, written once per frame.
+struct SpriteBatch {
+    const MeshAtlas *atlas = nullptr;
+    InstancedRenderer instances;    // Owns the frame's instance and resident static buffers, which sdf draws from too
+    InstancedRenderer sdf;      // Same instance layout, MESH_SDF_* quads and the SDF fragment shader
+    FrameUniformBuffer frame;
+    unsigned int program = 0;
+    int layerLocation = -1;
+    unsigned int vao = 0, vbo = 0, ebo = 0;
+    size_t vertexCapacity = 0, indexCapacity = 0;
+
+    RenderQueue queue;
+    SpriteBatchStats stats;
+
+    void init(const MeshAtlas &meshAtlas, unsigned int instancedProgram, unsigned int sdfProgram,
+              unsigned int streamProgram) {
+        atlas = &meshAtlas;
+        frame.init();
+        instances.init(meshAtlas, instancedProgram);
+        sdf.init(meshAtlas, sdfProgram);
+        program = streamProgram;
+        layerLocation = glGetUniformLocation(program, "uLayer");
+        FrameUniformBuffer::attach(program);
+
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ebo);
+        glState.bindVertexArray(vao);
+        glState.bindBuffer(GL_ARRAY_BUFFER, vbo);
+        glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void *)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex),
+                              (void *)offsetof(SpriteVertex, color));
+        glEnableVertexAttribArray(1);
+    }
+
+    // cameraOffset is scrolled by each layer's parallax; animationTime drives
+    // the instanced shader's sine animations
+    void begin(float cameraOffset, float animationTime) {
+        instances.beginFrame();
+        sdf.beginFrame();
+        frame.update(cameraOffset, animationTime);
+        queue.clear();
+        stats = SpriteBatchStats();
+    }
+
+    // Build the queue into batches and upload the frame's instances and stream buffers
+    void end() {
+        queue.build(*atlas);
+
+        instances.upload(queue.sortedInstances);
+        glState.bindVertexArray(vao);
+        glState.bindBuffer(GL_ARRAY_BUFFER, vbo);
+        const std::vector<SpriteVertex> &vertices = queue.streamVertices;
+        const std::vector<uint32_t> &indices = queue.streamIndices;
+        if (vertices.size() > vertexCapacity)
+            vertexCapacity = vertices.size() * 2;
+        glBufferData(GL_ARRAY_BUFFER, vertexCapacity * sizeof(SpriteVertex), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(SpriteVertex), vertices.data());
+        if (indices.size() > indexCapacity)
+            indexCapacity = indices.size() * 2;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * sizeof(uint32_t), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(uint32_t), indices.data());
+
+        stats.intents = queue.intents;
+        stats.staticInstances = queue.staticInstances;
+        stats.instances = (int)queue.sortedInstances.size();
+        stats.vertices = (int)vertices.size();
+        stats.indices = (int)indices.size();
+        stats.uploadedBytes = instances.uploadedBytes + sdf.uploadedBytes + vertices.size() * sizeof(SpriteVertex) +
+                              indices.size() * sizeof(uint32_t) + sizeof(FrameConstants);
+    }
+
+    // Execute every batch, back to front
+    void drawAll() {
+        drawLayers(LAYER_MOUNTAINS, LAYER_PLAYER);
+    }
+
+    // Execute the batches of layers first..last, back to front. Batches are
+    // sorted by layer, so consecutive ranges together draw the whole frame.
+    void drawLayers(DrawLayer first, DrawLayer last) {
+        for (const RenderBatch &batch : queue.batches) {
+            if (batch.layer < first || batch.layer > last)
+                continue;
+            switch (batch.shader) {
+            case SPRITE_SHADER_STATIC:
+                instances.drawStatic(batch.layer, batch.mesh, batch.first, batch.count);
+                break;
+            case SPRITE_SHADER_INSTANCED:
+                instances.drawSlice(batch.layer, batch.mesh, instances.instanceVBO, batch.first, batch.count);
+                break;
+            case SPRITE_SHADER_SDF_STATIC:
+                sdf.drawSlice(batch.layer, batch.mesh, instances.staticVBO,
+                              instances.staticStart[batch.layer][batch.mesh] + batch.first, batch.count);
+                break;
+            case SPRITE_SHADER_SDF:
+                sdf.drawSlice(batch.layer, batch.mesh, instances.instanceVBO, batch.first, batch.count);
+                break;
+            case SPRITE_SHADER_STREAM:
+                glState.useProgram(program);
+                glState.uniform1i(layerLocation, batch.layer);
+                glState.bindVertexArray(vao);
+                glDrawElements(GL_TRIANGLES, (GLsizei)batch.count, GL_UNSIGNED_INT,
+                               (void *)(batch.first * sizeof(uint32_t)));
+                break;
+            }
+            stats.batches++;
+        }
+    }
+
+    void destroy() {
+        instances.destroy();
+        sdf.destroy();
+        frame.destroy();
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &vbo);
+        glDeleteBuffers(1, &ebo);
+        glDeleteProgram(program);
+    }
+};
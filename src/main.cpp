@@ -4,6 +4,19 @@
 #include "GameObjects.h"
 #include "Shaders.h"
 #include "Utils.h"
+#include "MeshAtlas.h"
+#include "Renderer.h"
+#include "Simulation.h"
+#include "Replay.h"
+#include "Rewind.h"
+#include "SimulationThread.h"
+#include "SpriteBatch.h"
+#include "Culling.h"
+#include "LayerCache.h"
+#include "FrameCapture.h"
+#include "GpuProfiler.h"
+#include "DynamicResolution.h"
+#include "SoftwareRasterizer.h"
 #include "glm/glm.hpp"
 
 #include <iostream>
@@ -12,872 +25,819 @@
 #include <string>
 #include <sstream>
 #include <iomanip>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <thread>
 
 // Function prototypes
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
-void processInput(GLFWwindow *window);
-void restartGame(); // Changed from initGame to a more comprehensive restart function
-void initGameInternal(); // For core game object initialization
+InputState processInput(GLFWwindow *window);
 void displayInstructions();
-void updateHUD();
-void drawCircleVertices(float *vertices, int segments, float radius);
-void DrawCircle(unsigned int shaderProgram, unsigned int VAO, int transformLoc, int colorLoc,
-                float x, float y, float size, const glm::vec4 &color);
-void DrawTriangle(unsigned int shaderProgram, unsigned int VAO, int transformLoc, int colorLoc,
-                  float x, float y, float size, const glm::vec4 &color);
-void drawCircle();
-void drawTriangle();
-
-// Game state
-float cameraOffset = 0.0f;
-bool gameOver = false;
-bool gameWin = false;
-int score = 0;
-float screenRightLimit = 0.5f; // Right limit for camera to start following
-
-// Game objects
-Player player;
-std::vector<Platform> platforms;
-std::vector<Enemy> enemies;
-std::vector<Coin> coins;
-std::vector<Cloud> clouds;
-std::vector<Bird> birds;
-std::vector<Mountain> mountains;
-std::vector<Tree> trees;
-
-Flag levelFlag(LEVEL_END_X, -0.3f);
+void printBatchStats(const SpriteBatchStats &stats);
+void printCullStats(const CullStats &stats);
+void printGLStateStats(const GLStateStats &stats);
+void printCaptureStats(FrameCapture &capture);
+void printGpuTimings(const GpuProfiler &profiler);
+void printResolutionStats(const ResolutionStats &stats);
+void printStreamStats(LevelStream &stream);
+void printRewindStats(const RewindStats &stats);
+void buildStaticScene(StaticScene &scene, const SceneCuller &culler);
+void hideCollectedCoins(StaticScene &scene, const SceneCuller &culler, BitSet &shown);
+void queueScene(RenderQueue &queue, SceneCuller &culler, float camera, float alpha, bool cachedLayers);
+bool runSoftware(int width, int height, long long frames, float tickRate, uint32_t seed, int threads, bool pan,
+                 const std::string &capturePath, const std::string &goldenPath);
+
+// Game state and objects, stepped by stepWorld()
+World world;
+
+const glm::vec4 SKY_COLOR(0.4f, 0.6f, 1.0f, 1.0f);    // Background, behind every layer
+
+// Clouds bounce by a cosine of this amplitude. The bounce used to be integrated
+// per tick (y += sin(phase + 0.9 t) * 0.006 dt); this is its closed form.
+const float CLOUD_BOUNCE = 0.006f / 0.9f;
 
 // Triangle vertices are defined in Utils.h
 
-void DrawCircle(unsigned int shaderProgram, unsigned int VAO, int transformLoc, int colorLoc,
-                float x, float y, float size, const glm::vec4 &color)
+// Function to display instructions at the start
+void displayInstructions()
 {
-    Matrix4 transform;
-    transform.translate(x - cameraOffset, y, 0.0f);
-    transform.scale(size, size, 1.0f);
-    glUniformMatrix4fv(transformLoc, 1, GL_FALSE, transform.m);
-    glUniform4f(colorLoc, color.x, color.y, color.z, color.w);
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 32 + 2); // Draw circle with triangle fan
+    std::cout << "===== MARIO-LIKE PLATFORMER GAME =====" << std::endl;
+    std::cout << "Controls:" << std::endl;
+    std::cout << "  LEFT ARROW  - Move left (but cannot move behind camera)" << std::endl;
+    std::cout << "  RIGHT ARROW - Move right" << std::endl;
+    std::cout << "  SPACE/UP    - Jump" << std::endl;
+    std::cout << "  R           - Restart game" << std::endl;
+    std::cout << "  BACKSPACE   - Hold to rewind" << std::endl;
+    std::cout << "  P           - Print GPU time per render pass" << std::endl;
+    std::cout << "  ESC         - Quit game" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Objectives:" << std::endl;
+    std::cout << "  - Collect coins for points" << std::endl;
+    std::cout << "  - Avoid red enemies" << std::endl;
+    std::cout << "  - Reach the green flag to win" << std::endl;
+    std::cout << "=====================================" << std::endl;
 }
 
-void DrawTriangle(unsigned int shaderProgram, unsigned int VAO, int transformLoc, int colorLoc,
-                  float x, float y, float size, const glm::vec4 &color)
+// Print the sprite batcher's counters for the last frame
+void printBatchStats(const SpriteBatchStats &stats)
 {
-    Matrix4 transform;
-    transform.translate(x - cameraOffset, y, 0.0f);
-    transform.scale(size, size, 1.0f);
-    glUseProgram(shaderProgram);
-    glUniformMatrix4fv(transformLoc, 1, GL_FALSE, transform.m);
-    glUniform4f(colorLoc, color.x, color.y, color.z, color.w);
-    glBindVertexArray(VAO);
-    drawTriangle();
+    std::cout << "\n[batch] intents: " << stats.intents
+              << " | draw calls: " << stats.batches
+              << " | instances: " << stats.instances
+              << " | static: " << stats.staticInstances
+              << " | vertices: " << stats.vertices
+              << " | indices: " << stats.indices
+              << " | uploaded: " << stats.uploadedBytes << " bytes" << std::endl;
 }
 
-void drawCircle()
+// Print how many state changes reached the driver last frame
+void printGLStateStats(const GLStateStats &stats)
 {
-    // Draw a circle using triangle fan mode (center vertex + outline vertices)
-    const int circleSegments = 32;
-    glDrawArrays(GL_TRIANGLE_FAN, 0, circleSegments + 2);
+    std::cout << "[gl] binds issued: " << stats.issued << " | skipped as redundant: " << stats.skipped << std::endl;
 }
 
-void drawTriangle()
+// Print the frame capture's progress and its cost to the render thread
+void printCaptureStats(FrameCapture &capture)
 {
-    // Draw a simple triangle (3 vertices)
-    glDrawArrays(GL_TRIANGLES, 0, 3);
+    CaptureStats stats = capture.snapshot();
+    std::cout << "[capture] frames: " << stats.frames << " | written: " << stats.written
+              << " | render thread: " << capture.renderMsPerFrame() << " ms/frame"
+              << " | readback stalls: " << stats.stalls << " | writer waits: " << stats.writerWaits << std::endl;
 }
 
-void initBackground()
+// Print the GPU time of each render pass, averaged over the profiler's window
+void printGpuTimings(const GpuProfiler &profiler)
 {
-    // Create clouds at different positions and heights
-    clouds.push_back(Cloud(-0.8f, 0.7f));
-    clouds.push_back(Cloud(0.4f, 0.6f));
-    clouds.push_back(Cloud(1.5f, 0.8f));
-    clouds.push_back(Cloud(-0.2f, 0.75f)); // New cloud
-    clouds.push_back(Cloud(0.9f, 0.65f));  // New cloud
-    clouds.push_back(Cloud(2.0f, 0.7f));   // New cloud
-    clouds.push_back(Cloud(-1.2f, 0.55f)); // New cloud
-    clouds.push_back(Cloud(1.2f, 0.85f));  // New cloud
-
-    // Initialize birds
-    birds.push_back(Bird(-0.5f, 0.5f));
-    birds.push_back(Bird(0.2f, 0.4f));
-    birds.push_back(Bird(0.8f, 0.6f));
-    birds.push_back(Bird(1.4f, 0.5f));
-
-    // Initialize mountains with green colors and proper bottom alignment
-    mountains.push_back(Mountain(-0.8f, -0.7f, 0.8f, 0.4f,
-                                 glm::vec4(0.2f, 0.4f, 0.2f, 1.0f))); // Dark forest green
-    mountains.push_back(Mountain(0.2f, -0.55f, 1.0f, 0.5f,
-                                 glm::vec4(0.25f, 0.45f, 0.25f, 1.0f))); // Medium forest green
-    mountains.push_back(Mountain(1.0f, -0.55f, 0.9f, 0.45f,
-                                 glm::vec4(0.3f, 0.5f, 0.3f, 1.0f))); // Light forest green
-    mountains.push_back(Mountain(1.8f, -0.55f, 0.7f, 0.35f,
-                                 glm::vec4(0.35f, 0.55f, 0.35f, 1.0f))); // Lighter forest green
-
-    // Initialize trees with better spacing and sizing
-    trees.push_back(Tree(-0.9f, -0.4f, 0.2f));
-    trees.push_back(Tree(-0.3f, -0.4f, 0.25f));
-    trees.push_back(Tree(0.4f, -0.4f, 0.22f));
-    trees.push_back(Tree(1.2f, -0.4f, 0.23f));
-    trees.push_back(Tree(1.9f, -0.4f, 0.21f));
+    GpuTimings timings = profiler.timings();
+    std::cout << "[gpu]";
+    for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+        std::cout << " " << gpuPassNames[pass] << ": " << timings.ms[pass] << " ms |";
+    std::cout << " total: " << timings.totalMs << " ms (last " << timings.frames << " frames, "
+              << timings.dropped << " untimed)" << std::endl;
 }
 
-// Initialize game objects
-void initGameInternal() // Renamed to avoid conflict, called by restartGame
+// Print the dynamic resolution's scale and the frame time it steers by
+void printResolutionStats(const ResolutionStats &stats)
 {
-    // Reset game objects
-    platforms.clear();
-    enemies.clear();
-    coins.clear();
-
-    // Base platform position
-    float y = -0.5f;
-
-    // Create a series of platforms with gaps
-    // First platform (starting platform)
-    platforms.push_back(Platform(-1.0f, y, 0.5f, 0.1f));
-
-    // Second platform after a small gap
-    platforms.push_back(Platform(-0.3f, y, 0.4f, 0.1f));
-
-    // Third platform after gap
-    platforms.push_back(Platform(0.3f, y, 0.5f, 0.1f));
-
-    // Fourth platform
-    platforms.push_back(Platform(1.0f, y, 0.4f, 0.1f));
-
-    // Fifth platform (end platform)
-    platforms.push_back(Platform(1.7f, y, 0.5f, 0.1f));
-
-    // After platforms are created
-    levelFlag.x = platforms.back().x + platforms.back().width/2 + 0.2f;
-    levelFlag.y = platforms.back().y;  // Match platform height
-    
-    // Add enemies at strategic positions with faster movement
-    Enemy enemy1(0.3f, -0.4f);
-    enemy1.velocity = 0.0002f; // Doubled speed
-    enemies.push_back(enemy1);
-
-    Enemy enemy2(1.7f, -0.4f);
-    enemy2.velocity = 0.0002f; // Doubled speed
-    enemies.push_back(enemy2);
-
-    // Add coins over gaps and platforms
-    coins.push_back(Coin(-0.6f, -0.2f)); // First platform
-    coins.push_back(Coin(-0.1f, -0.2f)); // Over first gap
-    coins.push_back(Coin(0.5f, -0.2f));  // Third platform
-    coins.push_back(Coin(0.7f, -0.2f));  // Third platform
-    coins.push_back(Coin(1.4f, -0.2f));  // Over last gap
-
-    // Position flag at the end of the last platform
-    levelFlag.x = 2.0f;
-    levelFlag.y = -0.3f;
+    std::cout << "[resolution] scale: " << stats.scale << " (" << stats.width << "x" << stats.height << ")"
+              << " | frame: " << stats.frameMs << " ms, target " << stats.targetMs << " ms"
+              << " | hysteresis: down above " << stats.targetMs * RESOLUTION_SLOW << " ms, up below "
+              << stats.targetMs * RESOLUTION_FAST << " ms | changes: " << stats.downs << " down, " << stats.ups
+              << " up" << std::endl;
 }
 
-// Function to display instructions at the start
-void displayInstructions()
+// Print chunk generation cost and how the resident window is keeping up
+void printStreamStats(LevelStream &stream)
 {
-    std::cout << "===== MARIO-LIKE PLATFORMER GAME =====" << std::endl;
-    std::cout << "Controls:" << std::endl;
-    std::cout << "  LEFT ARROW  - Move left (but cannot move behind camera)" << std::endl;
-    std::cout << "  RIGHT ARROW - Move right" << std::endl;
-    std::cout << "  SPACE/UP    - Jump" << std::endl;
-    std::cout << "  R           - Restart game" << std::endl;
-    std::cout << "  ESC         - Quit game" << std::endl;
-    std::cout << std::endl;
-    std::cout << "Objectives:" << std::endl;
-    std::cout << "  - Collect coins for points" << std::endl;
-    std::cout << "  - Avoid red enemies" << std::endl;
-    std::cout << "  - Reach the green flag to win" << std::endl;
-    std::cout << "=====================================" << std::endl;
+    StreamStats stats = stream.snapshot();
+    std::cout << "[stream] chunks generated: " << stats.generated << " | generate: "
+              << (stats.generated > 0 ? stats.generateMs / stats.generated : 0.0) << " ms avg, "
+              << stats.maxGenerateMs << " ms max | resident: " << stats.resident << " | free: " << stats.free
+              << " of " << LevelStream::POOL << " | window moves: " << stats.moves << " | stalls: " << stats.stalls
+              << std::endl;
 }
 
-// Function to draw text on screen (simulated with console output)
-void updateHUD()
+// Print how much rewind history is held and what it costs per second
+void printRewindStats(const RewindStats &stats)
 {
-    // Clear previous line
-    std::cout << "\r                                                 ";
-    // Display the score and coins collected
-    int coinsCollected = 0;
-    for (const Coin &coin : coins)
-    {
-        if (coin.collected)
-            coinsCollected++;
-    }
-    std::cout << "\rScore: " << std::setw(6) << std::setfill('0') << score
-              << " | Coins: " << coinsCollected << "/" << coins.size();
-    std::cout.flush();
+    std::cout << "[rewind] history: " << stats.seconds << " s (" << stats.frames << " frames, " << stats.keyframes
+              << " keyframes) | " << stats.bytesPerSecond << " bytes/s, raw " << stats.rawBytesPerSecond
+              << " bytes/s | buffer: " << stats.usedBytes << " of " << stats.capacityBytes << " bytes" << std::endl;
 }
 
-void restartGame() {
-    // Reset player state
-    player.x = -0.8f;
-    player.y = -0.3f;
-    player.velocityY = 0.0f;
-    player.isJumping = false;
-    player.animTime = 0.0f;
-    player.animFrame = 0;
-    player.facingRight = true;
-
-    // Reset game state variables
-    cameraOffset = 0.0f;
-    gameOver = false;
-    gameWin = false;
-    score = 0;
-
-    // Clear and reinitialize game objects
-    // initGameInternal will clear and repopulate platforms, enemies, coins
-    initGameInternal();    // This also resets levelFlag position
-
-    // Clear and reinitialize background elements
-    clouds.clear();
-    birds.clear();
-    mountains.clear();
-    trees.clear();
-    initBackground(); // Repopulate background elements
-
-    // Update HUD to reflect reset state
-    updateHUD();
+// Resident instance of coin i; collected coins stay in the buffer with zero size
+SpriteInstance coinInstance(size_t i)
+{
+    const CoinStore &coins = world.coins;
+    float scale = coins.collected.test(i) ? 0.0f : 1.0f;
+    return {coins.x[i], coins.y[i], coins.width[i] * scale, coins.height[i] * scale,
+            glm::vec4(1.0f, 0.84f, 0.0f, 1.0f), glm::vec4(0.0f)}; // Gold coins
 }
 
-unsigned int VBO, VAO, circleVAO, circleVBO, triangleVAO, triangleVBO;
-float diamondVertices[] = {
-    0.0f, 1.0f, 0.0f,  // top
-    1.0f, 0.0f, 0.0f,  // right
-    0.0f, -1.0f, 0.0f, // bottom
-    -1.0f, 0.0f, 0.0f, // left
-    0.0f, 1.0f, 0.0f,  // top (repeated for triangle fan)
-};
-
-unsigned int diamondVAO, diamondVBO;
-
-int main()
+// Bucket the level's entities that never move in the culler's key order,
+// so each frame shows one slice per bucket
+void buildStaticScene(StaticScene &scene, const SceneCuller &culler)
 {
-    // glfw: initialize and configure
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    scene.clear();
 
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
+    // Mountains (triangular shape)
+    for (uint32_t i : culler.mountains.ids)
+    {
+        const Mountain &mountain = world.mountains[i];
+        scene.add(LAYER_MOUNTAINS, MESH_TRIANGLE, mountain.x, mountain.y,
+                  mountain.width * 2.0f, mountain.height * 2.0f, mountain.color, glm::vec4(0.0f));
+    }
 
-    // glfw window creation
-    GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Mario-like Platformer", NULL, NULL);
-    if (window == NULL)
+    // Platforms and trees bob with the same wave
+    const glm::vec4 floatAnim = spriteAnim(0.0f, PLATFORM_FLOAT_AMPLITUDE, PLATFORM_FLOAT_SPEED, 0.0f);
+
+    for (uint32_t i : culler.trees.ids)
     {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+        const Tree &tree = world.trees[i];
+        scene.add(LAYER_TREES, MESH_RECT, tree.x, tree.y, tree.size * 0.2f, tree.size * 0.8f,
+                  glm::vec4(0.45f, 0.3f, 0.2f, 1.0f), floatAnim); // Brown trunk
+        scene.add(LAYER_TREES, MESH_TRIANGLE, tree.x, tree.y + tree.size * 0.8f,
+                  tree.size * 1.2f, tree.size * 1.5f, glm::vec4(0.1f, 0.6f, 0.1f, 1.0f), floatAnim); // Green crown
     }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-    // glad: load all OpenGL function pointers
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    // Clouds: one SDF quad holding all four overlapping circles, which
+    // MESH_SDF_CLOUD lays out in units of the cloud's size
+    for (uint32_t i : culler.clouds.ids)
     {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+        const Cloud &cloud = world.clouds[i];
+        float cloudY = cloud.y + CLOUD_BOUNCE * cos(cloud.bounceOffset);
+        glm::vec4 bounce = spriteAnim(cloud.bounceOffset + 1.5707963f, -CLOUD_BOUNCE, 0.9f, 0.0f);
+        scene.add(LAYER_CLOUDS, MESH_SDF_CLOUD, cloud.x, cloudY, cloud.size, cloud.size,
+                  glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), bounce);
     }
 
-    // build and compile our shader program
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
+    // Platforms, drawn from the rest height; the shader applies the same wave the simulation uses
+    const PlatformStore &platforms = world.platforms;
+    for (uint32_t i : culler.platforms.ids)
+    {
+        scene.add(LAYER_WORLD, MESH_RECT, platforms.x[i], platforms.initialY[i], platforms.width[i],
+                  platforms.height[i], glm::vec4(0.5f, 0.35f, 0.05f, 1.0f), floatAnim); // Brown platforms
+    }
 
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
+    // Coins (no rotation)
+    for (uint32_t i : culler.coins.ids)
     {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n"
-                  << infoLog << std::endl;
+        SpriteInstance coin = coinInstance(i);
+        scene.add(LAYER_COINS, MESH_DIAMOND, coin.x, coin.y, coin.width, coin.height, coin.color, coin.anim);
     }
 
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
+    scene.finish();
+}
 
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
+// Rewrite the static instance of every coin whose collected bit differs
+// from what the scene last showed
+void hideCollectedCoins(StaticScene &scene, const SceneCuller &culler, BitSet &shown)
+{
+    const BitSet &collected = world.coins.collected;
+    for (size_t w = 0; w < collected.words.size(); w++)
     {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n"
-                  << infoLog << std::endl;
+        uint64_t changed = collected.words[w] ^ shown.words[w];
+        for (; changed; changed &= changed - 1)
+        {
+            size_t i = w * 64 + (size_t)__builtin_ctzll(changed);
+            scene.update(LAYER_COINS, MESH_DIAMOND, culler.coins.position[i], coinInstance(i));
+        }
     }
+    shown = collected;
+}
 
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success)
+// Queue the frame's draw intents at the render point alpha of the way
+// between the last two ticks. Entities that never move are shown as slices
+// of the StaticScene buckets; mountains and trees only when the backend has
+// no LayerCache drawing them (cachedLayers false).
+void queueScene(RenderQueue &queue, SceneCuller &culler, float camera, float alpha, bool cachedLayers)
+{
+    // Static layers only pick the slice of their resident instances that covers the view
+    size_t first, count;
+    if (!cachedLayers)
     {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n"
-                  << infoLog << std::endl;
+        culler.cullSlice(LAYER_MOUNTAINS, culler.mountains, camera * layerParallax[LAYER_MOUNTAINS], [&](uint32_t id) {
+            const Mountain &m = world.mountains[id];
+            return centeredBox(m.x, m.y, m.width * 2.0f, m.height * 2.0f);
+        }, first, count);
+        queue.showStatic(LAYER_MOUNTAINS, MESH_TRIANGLE, first, count);
+        // Trunk and crown buckets hold one instance per tree, in the same order
+        culler.cullSlice(LAYER_TREES, culler.trees, camera * layerParallax[LAYER_TREES], [&](uint32_t id) {
+            const Tree &t = world.trees[id];
+            return CollisionBox{t.x - t.size * 0.6f, t.y - t.size * 0.4f - PLATFORM_FLOAT_AMPLITUDE,
+                                t.x + t.size * 0.6f, t.y + t.size * 1.55f + PLATFORM_FLOAT_AMPLITUDE};
+        }, first, count);
+        queue.showStatic(LAYER_TREES, MESH_RECT, first, count);
+        queue.showStatic(LAYER_TREES, MESH_TRIANGLE, first, count);
     }
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
-    float vertices[] = {
-        -0.5f, -0.5f, 0.0f,
-        0.5f, -0.5f, 0.0f,
-        0.5f, 0.5f, 0.0f,
-        -0.5f, -0.5f, 0.0f,
-        0.5f, 0.5f, 0.0f,
-        -0.5f, 0.5f, 0.0f};
-
-    // Set up the VAO/VBO for rectangular shapes (platforms, player, enemies, etc.)
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
-
-    // Circle setup (for sun/clouds)
-    glGenVertexArrays(1, &circleVAO);
-    glGenBuffers(1, &circleVBO);
-
-    // Triangle setup (for birds)
-    glGenVertexArrays(1, &triangleVAO);
-    glGenBuffers(1, &triangleVBO);
-
-    // Diamond setup (for coins)
-    glGenVertexArrays(1, &diamondVAO);
-    glGenBuffers(1, &diamondVBO);
-
-    // Circle vertices (dynamic)
-    // Circle setup with proper sizing
-    const int circleSegments = 32;
-    float circleVertices[(circleSegments + 2) * 3]; // +2 for center vertex and closing vertex
-    drawCircleVertices(circleVertices, circleSegments, 1.0f);
-
-    glBindVertexArray(circleVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, circleVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(circleVertices), circleVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
-
-    // Triangle vertices setup
-    glBindVertexArray(triangleVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, triangleVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(triangleVertices), triangleVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
-
-    // Diamond vertices setup
-    glBindVertexArray(diamondVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, diamondVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(diamondVertices), diamondVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
-
-    // Initialize game objects
-    restartGame(); // Initial setup of the game state
-    // initBackground() is called within restartGame()
-
-    glUseProgram(shaderProgram);
-    int transformLoc = glGetUniformLocation(shaderProgram, "transform");
-    int colorLocation = glGetUniformLocation(shaderProgram, "ourColor");
-
-    // Make sure these uniform locations are correctly retrieved
-    transformLoc = glGetUniformLocation(shaderProgram, "transform");
-    colorLocation = glGetUniformLocation(shaderProgram, "ourColor");
-
-    // Check if uniform locations are valid
-    if (transformLoc == -1 || colorLocation == -1)
+
+    // Rotating sun with rays, fixed to the screen: two SDF quads. The disc
+    // and the rays pulse together; the SDF shader turns the rays.
+    const glm::vec4 sunPulse = spriteAnim(0.0f, 0.0f, 2.0f, 0.01f);
+    queue.circle(LAYER_SUN, -0.8f, 0.8f, 0.15f, glm::vec4(1.0f, 0.84f, 0.0f, 1.0f), sunPulse);
+    queue.shape(LAYER_SUN, MESH_SDF_RAYS, -0.8f, 0.8f, 1.0f, 1.0f,
+                glm::vec4(1.0f, 0.9f, 0.3f, 1.0f), sunPulse);
+
+    // Clouds, one SDF quad each. The side lobes reach 1.7 sizes out (0.8
+    // off center, radius 0.9) and the top one 1.0 up (0.3 up, radius 0.7).
+    culler.cullSlice(LAYER_CLOUDS, culler.clouds, camera, [&](uint32_t id) {
+        const Cloud &c = world.clouds[id];
+        float y = c.y + CLOUD_BOUNCE * cos(c.bounceOffset);
+        return CollisionBox{c.x - 1.7f * c.size, y - c.size - CLOUD_BOUNCE,
+                            c.x + 1.7f * c.size, y + (0.3f + 0.7f) * c.size + CLOUD_BOUNCE};
+    }, first, count);
+    queue.showStatic(LAYER_CLOUDS, MESH_SDF_CLOUD, first, count);
+
+    // Birds (triangles). Their flight is the integrated drift
+    // 0.05 / 0.9 * (1 - cos(0.9 t)) plus a 0.015 * sin(0.9 t) wobble, folded
+    // into one sine of the combined amplitude and phase.
+    const float birdDrift = 0.05f / 0.9f;
+    const float birdAmplitude = sqrt(0.015f * 0.015f + birdDrift * birdDrift);
+    const glm::vec4 birdFlight = spriteAnim(atan2(-birdDrift, 0.015f), birdAmplitude, 0.9f, 0.0f);
+    for (const Bird &bird : world.birds)
     {
-        std::cout << "Error: Failed to get uniform locations" << std::endl;
+        float birdX = lerp(bird.prevX, bird.x, alpha);
+        float birdY = bird.y + birdDrift;
+        if (culler.test(LAYER_BIRDS, camera, CollisionBox{birdX - 0.025f, birdY - 0.025f - birdAmplitude,
+                                                          birdX + 0.025f, birdY + 0.025f + birdAmplitude}))
+            queue.shape(LAYER_BIRDS, MESH_TRIANGLE, birdX, birdY,
+                        0.05f, 0.05f, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), birdFlight);
     }
 
-    double lastTime = glfwGetTime();
-    displayInstructions(); // Display instructions once at the very start
+    // Platforms, then enemies over them
+    const PlatformStore &platforms = world.platforms;
+    culler.cullSlice(LAYER_WORLD, culler.platforms, camera, [&](uint32_t id) {
+        return centeredBox(platforms.x[id], platforms.initialY[id], platforms.width[id],
+                           platforms.height[id] + 2 * PLATFORM_FLOAT_AMPLITUDE);
+    }, first, count);
+    queue.showStatic(LAYER_WORLD, MESH_RECT, first, count);
+    const EnemyStore &enemies = world.enemies;
+    for (uint32_t i : culler.cull(LAYER_WORLD, culler.enemies, camera, [&](uint32_t id) {
+             float scale = enemies.anim[id].baseScale + enemies.anim[id].zoomAmount;
+             return centeredBox(lerp(enemies.prevX[id], enemies.x[id], alpha), enemies.y[id],
+                                enemies.width[id] * scale, enemies.height[id] * scale);
+         }))
+    {
+        const EnemyAnim &anim = enemies.anim[i];
+        queue.quad(LAYER_WORLD, lerp(enemies.prevX[i], enemies.x[i], alpha), enemies.y[i],
+                   enemies.width[i] * anim.baseScale, enemies.height[i] * anim.baseScale,
+                   glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), // Red enemies, zoom pulsed by the backend
+                   spriteAnim(0.0f, 0.0f, anim.zoomSpeed, anim.zoomAmount / anim.baseScale));
+    }
 
-    // Main game loop
-    float lastFrame = 0.0f;
-    float deltaTime = 0.0f;
+    // Coins; collected ones are zero-sized in the resident buffer
+    const CoinStore &coins = world.coins;
+    culler.cullSlice(LAYER_COINS, culler.coins, camera, [&](uint32_t id) {
+        return centeredBox(coins.x[id], coins.y[id], coins.width[id] * 2, coins.height[id] * 2);
+    }, first, count);
+    queue.showStatic(LAYER_COINS, MESH_DIAMOND, first, count);
 
-    while (!glfwWindowShouldClose(window)) // Loop continues until ESC is pressed
+    // Flag base, pole and pennant; an endless level has no flag
+    if (!world.stream)
     {
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
-        // Handle game state transitions (win/loss) and auto-restart
-        if (gameOver || gameWin) {
-            if (gameWin) {
-                std::cout << std::endl << std::endl;
-                std::cout << "=====================================" << std::endl;
-                std::cout << "   CONGRATULATIONS! YOU WON!" << std::endl;
-                std::cout << "   Final Score: " << score << std::endl;
-                std::cout << "=====================================" << std::endl;
-            } else { // gameOver
-                std::cout << std::endl << std::endl;
-                std::cout << "=====================================" << std::endl;
-                std::cout << "   GAME OVER!" << std::endl;
-                std::cout << "   Final Score: " << score << std::endl;
-                std::cout << "=====================================" << std::endl;
-            }
-            // Optional: Add a small delay here for messages to be read before restart.
-            // For example, using a timer or glfwWaitEventsTimeout if input processing during pause is desired.
-            // For simplicity, we'll restart immediately.
-            // Example of a pause (would require event handling during pause):
-            // double pauseEndTime = glfwGetTime() + 2.0; // Pause for 2 seconds
-            // while(glfwGetTime() < pauseEndTime) {
-            //    glfwPollEvents(); // Keep processing events like ESC
-            //    if (glfwWindowShouldClose(window)) break;
-            // }
-            // if (glfwWindowShouldClose(window)) break; // Exit main loop if ESC was pressed during pause
-            restartGame(); // Resets game state, including gameOver and gameWin flags
-        }
+        queue.quad(LAYER_FLAG, world.levelFlag.x, world.levelFlag.y,
+                   0.1f, 0.05f, glm::vec4(0.5f, 0.35f, 0.05f, 1.0f));
+        queue.quad(LAYER_FLAG, world.levelFlag.x, world.levelFlag.y + 0.15f,
+                   0.02f, 0.3f, glm::vec4(0.7f, 0.7f, 0.7f, 1.0f));
+        queue.shape(LAYER_FLAG, MESH_PENNANT, world.levelFlag.x, world.levelFlag.y + 0.3f,
+                    0.08f, 0.1f, glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
+    }
 
-        // Update platform and tree positions
-        float floatSpeed = 2.0f;
-        float floatAmplitude = 0.03f;
+    // Player and eyes
+    float eyeDirection = world.player.facingRight ? 0.02f : -0.02f;
+    float playerX = lerp(world.player.prevX, world.player.x, alpha);
+    float playerY = lerp(world.player.prevY, world.player.y, alpha);
+    queue.quad(LAYER_PLAYER, playerX, playerY + (world.player.animFrame * 0.01f),
+               world.player.width, world.player.height, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)); // Blue player
+    queue.quad(LAYER_PLAYER, playerX + eyeDirection, playerY + 0.02f,
+               0.02f, 0.02f, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)); // White eyes
+}
 
-        for (Platform &platform : platforms)
-        {
-            platform.floatTimer += deltaTime;
-            platform.y = platform.initialY + sin(platform.floatTimer * floatSpeed) * floatAmplitude;
-        }
+// Print how many entities each layer submitted and culled last frame
+void printCullStats(const CullStats &stats)
+{
+    const char *names[LAYER_COUNT] = {"mountains", "trees", "sun", "clouds", "birds", "world", "coins", "flag", "player"};
+    std::cout << "[cull]";
+    for (int layer = 0; layer < LAYER_COUNT; layer++)
+    {
+        if (stats.submitted[layer] + stats.culled[layer] > 0)
+            std::cout << " " << names[layer] << " " << stats.submitted[layer] << "/"
+                      << stats.submitted[layer] + stats.culled[layer];
+    }
+    std::cout << " (submitted/total)" << std::endl;
+}
 
-        for (Tree &tree : trees)
+// Render the scripted headless run (see headlessInput) with the software
+// rasterizer, one frame per tick at width x height, without a window or GL
+// context. With pan, the view sweeps the level back and forth at walking
+// speed instead of following the player, so every parallax layer scrolls.
+// Frames are written to capturePath like --capture; with goldenPath, each
+// one is compared with goldenPath_NNNNN.ppm. Returns false if a golden
+// image is missing or differs.
+bool runSoftware(int width, int height, long long frames, float tickRate, uint32_t seed, int threads, bool pan,
+                 const std::string &capturePath, const std::string &goldenPath)
+{
+    const int GOLDEN_TOLERANCE = 2;     // Per-channel slack for libm differences between platforms
+
+    MeshAtlas atlas;
+    atlas.build();
+    SoftwareRasterizer raster;
+    raster.init(atlas, width, height, threads);
+    FrameCapture capture;
+    if (!capturePath.empty())
+        capture.start(capturePath, width, height, (int)tickRate);
+
+    SceneCuller culler;
+    StaticScene staticScene;
+    BitSet shownCoins;
+    RenderQueue queue;
+    world.seed = seed;
+    restartWorld(world);
+    const float dt = 1.0f / tickRate;
+
+    double setupMs = 0.0, binMs = 0.0, rasterMs = 0.0;
+    long long primitives = 0, binned = 0, goldenFrames = 0, goldenMismatches = 0, firstMismatch = -1;
+    std::vector<uint8_t> golden;
+    auto start = std::chrono::steady_clock::now();
+    for (long long frame = 0; frame < frames; frame++)
+    {
+        if (world.gameOver || world.gameWin)
+            restartWorld(world);
+        stepWorld(world, headlessInput(world), dt);
+        float camera = world.cameraOffset;
+        if (pan)
         {
-            tree.floatTimer += deltaTime;
-            tree.y = tree.initialY + sin(tree.floatTimer * floatSpeed) * floatAmplitude;
+            float span = std::max(world.levelFlag.x, 1.0f);
+            camera = fmod(frame * dt * MOVEMENT_SPEED, 2.0f * span);
+            if (camera > span)
+                camera = 2.0f * span - camera;
         }
 
-        player.animTime += deltaTime;
-        if (player.animTime > 0.2f)
+        queue.clear();
+        if (culler.beginFrame(world))
         {
-            player.animTime = 0.0f;
-            player.animFrame = (player.animFrame + 1) % 2;
+            buildStaticScene(staticScene, culler);
+            shownCoins = world.coins.collected;
         }
-
-        processInput(window);
-
-        // Apply gravity
-        player.velocityY -= GRAVITY * deltaTime * 1000;
-        player.y += player.velocityY;
-
-        // Check for platform collisions
-        bool onGround = false;
-        for (const Platform &platform : platforms)
+        hideCollectedCoins(staticScene, culler, shownCoins);
+        queueScene(queue, culler, camera, 1.0f, false);
+        queue.build(atlas);
+        raster.render(queue, staticScene, camera, world.worldTime, SKY_COLOR);
+
+        const SoftwareStats &stats = raster.stats;
+        setupMs += stats.setupMs;
+        binMs += stats.binMs;
+        rasterMs += stats.rasterMs;
+        primitives += stats.triangles + stats.sdfQuads;
+        binned += stats.binned;
+        const uint8_t *rgba = (const uint8_t *)raster.pixels.data();
+        capture.submit(rgba);
+
+        if (!goldenPath.empty())
         {
-            if (checkCollision(
-                    player.x - player.width / 2, player.y - player.height / 2, player.width, player.height,
-                    platform.x - platform.width / 2, platform.y - platform.height / 2, platform.width, platform.height))
+            char suffix[32];
+            std::snprintf(suffix, sizeof(suffix), "_%05lld.ppm", frame);
+            int goldenWidth = 0, goldenHeight = 0;
+            long long differing = -1;
+            if (readPPM(goldenPath + suffix, goldenWidth, goldenHeight, golden) &&
+                goldenWidth == width && goldenHeight == height)
             {
-
-                // Check if player is landing on top of platform
-                if (player.velocityY < 0 &&
-                    (player.y - player.height / 2) > (platform.y + platform.height / 2 - 0.01f))
+                differing = 0;
+                for (int y = 0; y < height; y++)
                 {
-                    player.y = platform.y + platform.height / 2 + player.height / 2;
-                    player.velocityY = 0;
-                    onGround = true;
+                    const uint8_t *ours = rgba + (size_t)(height - 1 - y) * width * 4;
+                    const uint8_t *theirs = golden.data() + (size_t)y * width * 3;
+                    for (int x = 0; x < width; x++)
+                        for (int c = 0; c < 3; c++)
+                            if (std::abs(ours[x * 4 + c] - theirs[x * 3 + c]) > GOLDEN_TOLERANCE)
+                            {
+                                differing++;
+                                break;
+                            }
                 }
             }
-        }
-
-        if (onGround)
-        {
-            player.isJumping = false;
-        }
-
-        // Check if player fell off the screen
-        if (player.y < -1.0f && !gameOver && !gameWin) // Prevent re-triggering if already over
-        {
-            gameOver = true;
-        }
-
-        // Camera follows player
-        cameraOffset = player.x - screenRightLimit;
-        if (cameraOffset < 0)
-            cameraOffset = 0; // Don't let camera go past left edge
-
-        // Update enemies
-        for (Enemy &enemy : enemies)
-        {
-            enemy.x += enemy.velocity;
-            if (enemy.x > enemy.patrolRight || enemy.x < enemy.patrolLeft)
-            {
-                enemy.velocity = -enemy.velocity;
-            }
-
-            // Check for collision with enemy
-            if (checkCollision(
-                    player.x - player.width / 2, player.y - player.height / 2, player.width, player.height,
-                    enemy.x - enemy.width / 2, enemy.y - enemy.height / 2, enemy.width, enemy.height))
-            {   
-                if (!gameOver && !gameWin) // Prevent re-triggering
-                gameOver = true;
-            }
-        }
-
-        // Check coin collection
-        for (Coin &coin : coins)
-        {
-            if (!coin.collected && checkCollision(
-                                       player.x - player.width / 2, player.y - player.height / 2, player.width, player.height,
-                                       coin.x - coin.width / 2, coin.y - coin.height / 2, coin.width, coin.height))
+            goldenFrames++;
+            if (differing != 0)
             {
-                coin.collected = true;
-                score += 100;
+                goldenMismatches++;
+                if (firstMismatch < 0)
+                {
+                    firstMismatch = frame;
+                    if (differing < 0)
+                        std::cout << "software: golden image " << goldenPath + suffix << " missing or wrong size\n";
+                    else
+                        std::cout << "software: frame " << frame << " differs from its golden image in "
+                                  << differing << " pixels\n";
+                }
             }
         }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const int threadCount = raster.workers.count();
+    capture.finish();
+    raster.destroy();
+
+    std::cout << "software: " << frames << " frames at " << width << "x" << height << " in " << seconds << " s ("
+              << (seconds > 0.0 ? frames / seconds : 0.0) << " fps), " << threadCount << " threads, "
+              << RASTER_SIMD_NAME << " edges\n"
+              << "software: per frame " << setupMs / frames << " ms setup, " << binMs / frames << " ms binning, "
+              << rasterMs / frames << " ms raster; " << primitives / frames << " primitives in "
+              << binned / frames << " tile references\n";
+    if (!goldenPath.empty())
+        std::cout << "software: " << goldenFrames - goldenMismatches << "/" << goldenFrames
+                  << " frames match their golden images" << std::endl;
+    return goldenMismatches == 0;
+}
 
-        // Check if player reached the flag
-        if (!gameWin && !gameOver && checkCollision( // Prevent re-triggering
-                player.x - player.width / 2, player.y - player.height / 2, player.width, player.height,
-                levelFlag.x - levelFlag.width / 2, levelFlag.y - levelFlag.height / 2, levelFlag.width, levelFlag.height))
-        {
-            
-            gameWin = true;
-        }
+int main(int argc, char **argv)
+{
+    // Command line options
+    bool showStats = false;              // --stats: print batching counters once per second
+    float simTickRate = SIM_TICK_RATE;   // --sim-hz N: fixed simulation rate
+    float fpsCap = 0.0f;                 // --fps N: cap the render rate, 0 = uncapped
+    float targetFps = 0.0f;              // --target-fps N: scale the render resolution to hold N fps, 0 = off
+    bool headless = false;               // --headless: run the simulation without a window
+    long long headlessTicks = 0;         // --ticks N: how many ticks a headless run steps (1000000) or frames a software run renders (600)
+    int stressEntities = 0;              // --entities N: extra entities per kind in headless runs
+    long long benchBoxes = 0;            // --bench-collision N: time the collision kernels on N boxes
+    long long benchDraws = 0;            // --bench-queue N: time the render queue on a frame of N draws
+    long long benchRewind = 0;           // --bench-rewind N: time recording and rewinding N ticks
+    float rewindSeconds = 10.0f;         // --rewind N: seconds of history BACKSPACE can rewind, 0 = off
+    uint32_t seed = 1;                   // --seed N: world RNG seed
+    std::string recordPath;              // --record FILE: save every tick's input
+    std::string replayPath;              // --replay FILE: re-simulate a recording headlessly
+    std::string levelPath;               // --level FILE: play a compiled level instead of the built-in one
+    bool endless = false;                // --endless: play a generated level streamed in ahead of the camera
+    bool serial = false;                 // --serial: step the simulation in the render loop instead of its own thread
+    std::string capturePath;             // --capture FILE: write every rendered frame to FILE.y4m or FILE_N.ppm
+    std::string gpuCsvPath;              // --gpu-csv FILE: append per-pass GPU time averages to FILE
+    int softwareWidth = 0, softwareHeight = 0;  // --software WxH: render a scripted run on the CPU
+    int rasterThreads = 0;               // --threads N: software rasterizer threads, 0 = one per hardware thread
+    std::string goldenPath;              // --golden PREFIX: compare software frames with PREFIX_N.ppm
+    bool pan = false;                    // --pan: the software run's view sweeps the level instead of following the player
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--stats")
+            showStats = true;
+        else if (arg == "--sim-hz" && i + 1 < argc)
+            simTickRate = (float)std::atof(argv[++i]);
+        else if (arg == "--fps" && i + 1 < argc)
+            fpsCap = (float)std::atof(argv[++i]);
+        else if (arg == "--target-fps" && i + 1 < argc)
+            targetFps = (float)std::atof(argv[++i]);
+        else if (arg == "--headless")
+            headless = true;
+        else if (arg == "--ticks" && i + 1 < argc)
+            headlessTicks = std::atoll(argv[++i]);
+        else if (arg == "--entities" && i + 1 < argc)
+            stressEntities = std::atoi(argv[++i]);
+        else if (arg == "--bench-collision" && i + 1 < argc)
+            benchBoxes = std::atoll(argv[++i]);
+        else if (arg == "--bench-queue" && i + 1 < argc)
+            benchDraws = std::atoll(argv[++i]);
+        else if (arg == "--bench-rewind" && i + 1 < argc)
+            benchRewind = std::atoll(argv[++i]);
+        else if (arg == "--rewind" && i + 1 < argc)
+            rewindSeconds = (float)std::atof(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc)
+            seed = (uint32_t)std::strtoul(argv[++i], NULL, 10);
+        else if (arg == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (arg == "--level" && i + 1 < argc)
+            levelPath = argv[++i];
+        else if (arg == "--endless")
+            endless = true;
+        else if (arg == "--serial")
+            serial = true;
+        else if (arg == "--capture" && i + 1 < argc)
+            capturePath = argv[++i];
+        else if (arg == "--gpu-csv" && i + 1 < argc)
+            gpuCsvPath = argv[++i];
+        else if (arg == "--software" && i + 1 < argc)
+            std::sscanf(argv[++i], "%dx%d", &softwareWidth, &softwareHeight);
+        else if (arg == "--threads" && i + 1 < argc)
+            rasterThreads = std::atoi(argv[++i]);
+        else if (arg == "--golden" && i + 1 < argc)
+            goldenPath = argv[++i];
+        else if (arg == "--pan")
+            pan = true;
+    }
+    if (simTickRate <= 0.0f)
+        simTickRate = SIM_TICK_RATE;
 
-        updateHUD();
+    // The level stays mapped for the whole run; every restart copies it into the world
+    LevelFile levelFile;
+    if (!levelPath.empty())
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (!levelFile.open(levelPath))
+            return 1;
+        world.level = levelFile.view();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "level: " << levelPath << ", " << world.level.entities() << " entities, mapped in " << ms
+                  << " ms" << std::endl;
+    }
+    // Endless: chunks are generated from the seed on a worker thread; the
+    // level above still supplies the player start and the birds
+    LevelStream levelStream;
+    if (endless)
+    {
+        levelStream.start();
+        world.stream = &levelStream;
+    }
 
-        // Rendering
-        glClearColor(0.4f, 0.6f, 1.0f, 1.0f); // Sky blue background
-        glClear(GL_COLOR_BUFFER_BIT);
+    // Headless: step the simulation only, without creating a window or GL context
+    if (!replayPath.empty())
+        return runReplay(replayPath, world.level, world.stream) ? 0 : 1;
+    if (benchBoxes > 0)
+    {
+        runCollisionBenchmark((size_t)benchBoxes);
+        return 0;
+    }
+    if (benchDraws > 0)
+    {
+        runRenderQueueBenchmark((size_t)benchDraws);
+        return 0;
+    }
+    if (benchRewind > 0)
+    {
+        runRewindBenchmark(benchRewind, rewindSeconds > 0.0f ? rewindSeconds : 10.0f, simTickRate, seed,
+                           world.level);
+        return 0;
+    }
+    if (softwareWidth > 0 && softwareHeight > 0)
+        return runSoftware(softwareWidth, softwareHeight, headlessTicks > 0 ? headlessTicks : 600, simTickRate,
+                           seed, rasterThreads, pan, capturePath, goldenPath) ? 0 : 1;
+    if (headless)
+    {
+        runHeadless(headlessTicks > 0 ? headlessTicks : 1000000, simTickRate, seed, stressEntities, world.level, world.stream);
+        return 0;
+    }
 
-        // Update bird logic (moved from drawing loop for better structure and deltaTime usage)
-        const float BIRD_ANGLE_SPEED = 0.6f; // Approx 0.01 rad/frame * 60 fps
-
-        for (Bird &bird : birds) {
-            // Bird speed is 0.03f in constructor, assume units/sec
-            float timeBasedFluctuation = (0.8f + sin((float)glfwGetTime() * 0.5f) * 0.2f); // Use glfwGetTime() for smooth sine wave
-            float effectiveSpeed = bird.speed * timeBasedFluctuation;
-
-            if (bird.movingRight) {
-                bird.x += effectiveSpeed * deltaTime;
-                if (bird.x > 2.5f + cameraOffset) // Adjust patrol limits relative to camera if they are world-space
-                    bird.movingRight = false;
-            } else {
-                bird.x -= effectiveSpeed * deltaTime;
-                if (bird.x < -1.5f + cameraOffset)
-                    bird.movingRight = true;
-            }
-            bird.angle += BIRD_ANGLE_SPEED * deltaTime;
-        }
+    // glfw: initialize and configure
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
 
-        // Cloud bouncing
-        for (Cloud &cloud : clouds) {
-            // Update bounce animation
-            float bounceFreq = 0.9f;  // Controls how fast the cloud bounces
-            float bounceAmount = 0.000006f; // Controls how much the cloud moves up/down
-            cloud.bounceOffset += deltaTime * bounceFreq;
-            
-            // Calculate vertical offset using sine wave
-            float verticalOffset = sin(cloud.bounceOffset) * bounceAmount;
-            cloud.y = cloud.y + verticalOffset;
-        }
+    // glfw window creation
+    GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Mario-like Platformer", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-        // Bird movement update (replace existing bird movement code)
-        const float BIRD_VERTICAL_SPEED = 0.3f;
-        const float BIRD_HORIZONTAL_SPEED = 0.2f;
-        const float BIRD_VERTICAL_RANGE = 0.05f;
-
-        for (Bird &bird : birds) {
-            // Horizontal movement
-            if (bird.movingRight) {
-                bird.x += BIRD_HORIZONTAL_SPEED * deltaTime;
-                if (bird.x > 2.5f + cameraOffset) {
-                    bird.movingRight = false;
-                }
-            } else {
-                bird.x -= BIRD_HORIZONTAL_SPEED * deltaTime;
-                if (bird.x < -1.5f + cameraOffset) {
-                    bird.movingRight = true;
-                }
-            }
-            
-            // Vertical movement (smooth sine wave)
-            bird.angle += BIRD_VERTICAL_SPEED * deltaTime;
-            bird.y = bird.y + sin(bird.angle) * BIRD_VERTICAL_RANGE * deltaTime;
-        }
+    // glad: load all OpenGL function pointers
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
 
-        // Draw mountains (triangular shape)
-        for (const Mountain &mountain : mountains)
-        {
-            // Draw mountain as a triangle
-            Matrix4 transform;
-            transform.translate(mountain.x - cameraOffset * 0.5f, mountain.y, 0.0f);
-
-            // Use triangleVAO for mountain shape
-            glBindVertexArray(triangleVAO);
-            transform.scale(mountain.width * 2.0f, mountain.height * 2.0f, 1.0f);
-            glUniformMatrix4fv(transformLoc, 1, GL_FALSE, transform.m);
-            glUniform4f(colorLocation,
-                        mountain.color.x,
-                        mountain.color.y,
-                        mountain.color.z,
-                        mountain.color.w);
-            glDrawArrays(GL_TRIANGLES, 0, 3);
-        }
+    // SDF shapes antialias their edges through alpha; every other shape is opaque.
+    // Alpha accumulates as coverage, so offscreen layers come out premultiplied.
+    glEnable(GL_BLEND);
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    // Every unit mesh lives in one immutable buffer pair; draws only pick a sub-range
+    MeshAtlas meshAtlas;
+    meshAtlas.init();
+
+    // Batcher for all shapes: translated/scaled meshes are drawn instanced from the
+    // atlas, rotated ones are expanded into one streaming buffer per frame
+    SpriteBatch spriteBatch;
+    SceneCuller culler;     // Skips entities outside the parallax-adjusted view
+    StaticScene staticScene;    // The level's entities that never move, resident in spriteBatch
+    BitSet shownCoins;      // Collected bits as last written to the static coin instances
+    LayerCache layerCache;  // Mountains and trees, rendered once per level into texture strips
+    layerCache.init(meshAtlas, createShaderProgram(instancedVertexShaderSource, layerCompositeFragmentShaderSource));
+    spriteBatch.init(meshAtlas,
+                     createShaderProgram(instancedVertexShaderSource, vertexColorFragmentShaderSource),
+                     createShaderProgram(instancedVertexShaderSource, sdfFragmentShaderSource),
+                     createShaderProgram(spriteBatchVertexShaderSource, vertexColorFragmentShaderSource));
+
+    // Initialize game objects. The simulation thread steps a world of its own;
+    // the one drawn here is a copy of its newest published tick. --serial steps
+    // the drawn world itself instead.
+    SimulationThread simulation;
+    World &simWorld = serial ? world : simulation.world;
+    simWorld.level = world.level;
+    simWorld.stream = world.stream;
+    simWorld.seed = seed;
+    restartWorld(simWorld); // Initial setup of the game state
+    // initBackground() is called within restartWorld()
+
+    // An input recording cannot express a rewind, so recording sessions go without
+    PlaySession &session = simulation.session;
+    session.recording = !recordPath.empty();
+    session.inputLog.seed = seed;
+    session.inputLog.tickRate = simTickRate;
+    session.rewindBuffer.init(recordPath.empty() ? rewindSeconds : 0.0f, simTickRate);
+    session.showHUD(simWorld);
+
+    // Frame capture reads back the default framebuffer at its size at startup
+    FrameCapture frameCapture;
+    if (!capturePath.empty())
+    {
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        frameCapture.start(capturePath, framebufferWidth, framebufferHeight, fpsCap > 0.0f ? (int)fpsCap : 60);
+    }
 
-        // Draw trees (after mountains but before other game elements)
-        for (const Tree &tree : trees)
-        {
-            // Draw trunk
-            Matrix4 trunkTransform;
-            trunkTransform.translate(tree.x - cameraOffset * 0.7f, tree.y, 0.0f);
-            trunkTransform.scale(tree.size * 0.2f, tree.size * 0.8f, 1.0f);
-            glUniformMatrix4fv(transformLoc, 1, GL_FALSE, trunkTransform.m);
-            glUniform4f(colorLocation, 0.45f, 0.3f, 0.2f, 1.0f); // Brown trunk
-            glBindVertexArray(VAO);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-
-            // Draw tree crown (triangle shape)
-            Matrix4 crownTransform;
-            crownTransform.translate(tree.x - cameraOffset * 0.7f, tree.y + tree.size * 0.8f, 0.0f);
-            crownTransform.scale(tree.size * 1.2f, tree.size * 1.5f, 1.0f);
-            glUniformMatrix4fv(transformLoc, 1, GL_FALSE, crownTransform.m);
-            glUniform4f(colorLocation, 0.1f, 0.6f, 0.1f, 1.0f); // Green crown
-            glBindVertexArray(triangleVAO);
-            glDrawArrays(GL_TRIANGLES, 0, 3);
-        }
+    // GPU time of each render pass, read back a few frames late so it never stalls
+    GpuProfiler gpuProfiler;
+    gpuProfiler.init(gpuCsvPath);
+    bool profileKeyDown = false;
 
-        // Draw rotating sun with rays
-        // Draw rotating sun with rays
-        {
-            float time = (float)glfwGetTime();
-            float rotationAngle = time * 0.2f;             // Rotation speed
-            float pulse = sin(time * 2.0f) * 0.01f + 1.0f; // Subtle pulsing effect
-
-            // Main sun circle
-            Matrix4 sunTransform;
-            // First scale (applied first)
-            sunTransform.scale(0.15f * pulse, 0.15f * pulse, 1.0f);
-            // Then rotate (applied second)
-            sunTransform.rotate(rotationAngle);
-            // Finally translate to position (applied last)
-            sunTransform.translate(-0.8f, 0.8f, 0.0f);
-
-            glUniformMatrix4fv(transformLoc, 1, GL_FALSE, sunTransform.m);
-            glUniform4f(colorLocation, 1.0f, 0.84f, 0.0f, 1.0f);
-            glBindVertexArray(circleVAO);
-            glDrawArrays(GL_TRIANGLE_FAN, 0, 32 + 2);
-
-            // Sun rays
-            for (int i = 0; i < 8; i++)
-            {
-                float rayAngle = rotationAngle + (i * 3.14159f / 4.0f);
-                float rayLength = 0.05f * pulse;
-
-                Matrix4 rayTransform;
-                // Order matters: scale -> rotate -> translate
-                rayTransform.scale(0.02f, rayLength, 1.0f);
-                rayTransform.rotate(rayAngle);
-                rayTransform.translate(-0.8f + cos(rayAngle) * 0.2f,
-                                       0.8f + sin(rayAngle) * 0.2f, 0.0f);
-
-                glUniformMatrix4fv(transformLoc, 1, GL_FALSE, rayTransform.m);
-                glUniform4f(colorLocation, 1.0f, 0.9f, 0.3f, 1.0f);
-                glBindVertexArray(triangleVAO);
-                glDrawArrays(GL_TRIANGLES, 0, 3);
-            }
-        }
-        // Clouds (circles)
-        for (const Cloud &cloud : clouds)
-        {
-            // Main cloud circle
-            DrawCircle(shaderProgram, circleVAO, transformLoc, colorLocation,
-                       cloud.x, cloud.y, cloud.size, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+    // Optional offscreen target whose resolution follows the frame time
+    DynamicResolution dynamicResolution;
+    if (targetFps > 0.0f)
+        dynamicResolution.init(targetFps);
 
-            // Additional circles to form a cloud shape
-            DrawCircle(shaderProgram, circleVAO, transformLoc, colorLocation,
-                       cloud.x + 0.08f, cloud.y, cloud.size * 0.8f, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+    double lastTime = glfwGetTime();
+    displayInstructions(); // Display instructions once at the very start
 
-            DrawCircle(shaderProgram, circleVAO, transformLoc, colorLocation,
-                       cloud.x - 0.08f, cloud.y, cloud.size * 0.9f, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+    // Main game loop
+    float lastFrame = 0.0f;
+    float deltaTime = 0.0f;
+    float lastStatsTime = 0.0f;
+    FixedTimestep timestep(simTickRate);
+    if (!serial)
+        simulation.start(simTickRate);
 
-            DrawCircle(shaderProgram, circleVAO, transformLoc, colorLocation,
-                       cloud.x, cloud.y + 0.03f, cloud.size * 0.7f, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
-        }
+    while (!glfwWindowShouldClose(window)) // Loop continues until ESC is pressed
+    {
+        float currentFrame = glfwGetTime();
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
 
-        // Birds (triangles)
-        // Drawing part of birds, positions are now updated above
-        for (const Bird &bird : birds) { // Iterate as const since we are only drawing
-            float yOffset = sin(bird.angle) * 0.015f; // bird.angle is updated with deltaTime
-            DrawTriangle(shaderProgram, triangleVAO, transformLoc, colorLocation,
-                         bird.x, bird.y + yOffset, 0.05f, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
-            // More complex bird drawing (wings) would also go here, using bird.x, bird.y, bird.angle
-        }
-        // Draw platforms
-        glBindVertexArray(VAO);
-        for (const Platform &platform : platforms)
+        // Sample input once per frame. Serially, run however many fixed ticks
+        // fit; otherwise hand the input over and take the newest published tick.
+        InputState input = processInput(window);
+        bool rewinding = session.rewindBuffer.enabled() && glfwGetKey(window, GLFW_KEY_BACKSPACE) == GLFW_PRESS;
+        float alpha;
+        if (serial)
         {
-            Matrix4 transform;
-            transform.translate(platform.x - cameraOffset, platform.y, 0.0f);
-            transform.scale(platform.width, platform.height, 1.0f);
-            glUniformMatrix4fv(transformLoc, 1, GL_FALSE, transform.m);
-            glUniform4f(colorLocation, 0.5f, 0.35f, 0.05f, 1.0f); // Brown color for platforms
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+            session.advance(world, input, rewinding, timestep.advance(deltaTime), timestep.tickSeconds);
+            alpha = timestep.alpha();
         }
-
-        // Draw enemies
-        for (Enemy &enemy : enemies)
+        else
         {
-            // Update scale animation
-            enemy.scaleTimer += deltaTime * enemy.zoomSpeed;
-            float currentScale = enemy.baseScale + sin(enemy.scaleTimer) * enemy.zoomAmount;
-            
-            Matrix4 transform;
-            transform.translate(enemy.x - cameraOffset, enemy.y, 0.0f);
-            transform.scale(enemy.width * currentScale, enemy.height * currentScale, 1.0f);
-            glUniformMatrix4fv(transformLoc, 1, GL_FALSE, transform.m);
-            glUniform4f(colorLocation, 1.0f, 0.0f, 0.0f, 1.0f); // Red enemies
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+            simulation.setInput(input, rewinding);
+            if (simulation.frames.acquire())
+                copyRenderState(world, simulation.frames.readSlot().world);
+            alpha = simulation.alpha(simulation.frames.readSlot());
         }
 
-        // Draw coins (no rotation)
-        for (Coin &coin : coins)
+        // Render between the last two ticks
+        float camera = lerp(world.prevCameraOffset, world.cameraOffset, alpha);
+        // World time at the interpolated render point; drives the shader's cosmetic animation
+        float animTime = world.worldTime - (1.0f - alpha) * timestep.tickSeconds;
+
+        // Queue the frame's draw intents; the batcher sorts and uploads them in end().
+        // Mountains and trees come from the layer cache when their strips fit.
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        glState.beginFrame();
+        spriteBatch.begin(camera, animTime);
+        if (culler.beginFrame(world))
         {
-            if (!coin.collected)
-            {
-                Matrix4 transform;
-                transform.translate(coin.x - cameraOffset, coin.y, 0.0f);
-                transform.scale(coin.width, coin.height, 1.0f);
-
-                glUniformMatrix4fv(transformLoc, 1, GL_FALSE, transform.m);
-                glUniform4f(colorLocation, 1.0f, 0.84f, 0.0f, 1.0f); // Gold coins
-                glBindVertexArray(diamondVAO);
-                glDrawArrays(GL_TRIANGLE_FAN, 0, 5);
-            }
+            // New level: the entities that never move are uploaded once and stay resident
+            buildStaticScene(staticScene, culler);
+            spriteBatch.instances.uploadStatic(staticScene);
+            shownCoins = world.coins.collected;
+            layerCache.invalidate();
         }
-
-        // Draw flag base/platform
+        layerCache.prepare(spriteBatch, staticScene, camera, animTime, framebufferWidth, framebufferHeight);
+        hideCollectedCoins(staticScene, culler, shownCoins);
+        spriteBatch.instances.syncStatic(staticScene);
+
+        queueScene(spriteBatch.queue, culler, camera, alpha, layerCache.active);
+        spriteBatch.end();
+
+        // Rendering, one timed pass per group of layers
+        gpuProfiler.beginFrame();
+        if (targetFps > 0.0f)
+            dynamicResolution.begin(framebufferWidth, framebufferHeight);
+        gpuProfiler.begin(GPU_PASS_BACKGROUND);
+        glClearColor(SKY_COLOR.r, SKY_COLOR.g, SKY_COLOR.b, SKY_COLOR.a);
+        glClear(GL_COLOR_BUFFER_BIT);
+        layerCache.draw();
+        spriteBatch.drawLayers(LAYER_MOUNTAINS, LAYER_BIRDS);
+        gpuProfiler.begin(GPU_PASS_OBJECTS);
+        spriteBatch.drawLayers(LAYER_WORLD, LAYER_COINS);
+        gpuProfiler.begin(GPU_PASS_FLAG_PLAYER);
+        spriteBatch.drawLayers(LAYER_FLAG, LAYER_PLAYER);
+        gpuProfiler.begin(GPU_PASS_UPSCALE);
+        if (targetFps > 0.0f)
+            dynamicResolution.end();
+        gpuProfiler.begin(GPU_PASS_READBACK);
+        frameCapture.capture();
+        gpuProfiler.endFrame();
+
+        bool profileKey = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+        if (profileKey && !profileKeyDown)
+            printGpuTimings(gpuProfiler);
+        profileKeyDown = profileKey;
+
+        if (showStats && currentFrame - lastStatsTime >= 1.0f)
         {
-            Matrix4 baseTransform;
-            baseTransform.translate(levelFlag.x - cameraOffset, levelFlag.y, 0.0f);
-            baseTransform.scale(0.1f, 0.05f, 1.0f);
-            glUniformMatrix4fv(transformLoc, 1, GL_FALSE, baseTransform.m);
-            glUniform4f(colorLocation, 0.5f, 0.35f, 0.05f, 1.0f);
-            glBindVertexArray(VAO);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+            lastStatsTime = currentFrame;
+            printBatchStats(spriteBatch.stats);
+            printCullStats(culler.stats);
+            printGLStateStats(glState.stats);
+            printGpuTimings(gpuProfiler);
+            if (targetFps > 0.0f)
+                printResolutionStats(dynamicResolution.stats);
+            if (frameCapture.active())
+                printCaptureStats(frameCapture);
+            if (world.stream)
+                printStreamStats(*world.stream);
+            if (session.rewindBuffer.enabled())
+                printRewindStats(serial ? session.rewindBuffer.stats() : simulation.frames.readSlot().rewind);
         }
 
-        // Draw flag pole
-        {
-            Matrix4 poleTransform;
-            poleTransform.translate(levelFlag.x - cameraOffset, levelFlag.y + 0.15f, 0.0f);
-            poleTransform.scale(0.02f, 0.3f, 1.0f);
-            glUniformMatrix4fv(transformLoc, 1, GL_FALSE, poleTransform.m);
-            glUniform4f(colorLocation, 0.7f, 0.7f, 0.7f, 1.0f);
-            glBindVertexArray(VAO);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-        }
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+        if (targetFps > 0.0f)
+            dynamicResolution.update((float)glfwGetTime() - currentFrame);
 
-        // Draw flag
+        // Optional render cap; the simulation rate is unaffected
+        if (fpsCap > 0.0f)
         {
-            float flagVertices[] = {
-                0.0f, 0.5f, 0.0f,
-                0.0f, -0.5f, 0.0f,
-                -1.0f, 0.0f, 0.0f
-            };
-
-            Matrix4 flagTransform;
-            flagTransform.translate(levelFlag.x - cameraOffset, levelFlag.y + 0.3f, 0.0f);
-            flagTransform.scale(0.08f, 0.1f, 1.0f);
-            
-            glUniformMatrix4fv(transformLoc, 1, GL_FALSE, flagTransform.m);
-            glUniform4f(colorLocation, 0.0f, 1.0f, 0.0f, 1.0f);
-            
-            glBindVertexArray(triangleVAO);
-            glBindBuffer(GL_ARRAY_BUFFER, triangleVBO);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(flagVertices), flagVertices, GL_STATIC_DRAW);
-            glDrawArrays(GL_TRIANGLES, 0, 3);
-            
-            // Restore original triangle vertices
-            glBufferData(GL_ARRAY_BUFFER, sizeof(triangleVertices), triangleVertices, GL_STATIC_DRAW);
+            float frameEnd = currentFrame + 1.0f / fpsCap;
+            float remaining = frameEnd - (float)glfwGetTime();
+            if (remaining > 0.0f)
+                std::this_thread::sleep_for(std::chrono::duration<float>(remaining));
         }
-
-        // Draw player
-        Matrix4 transform;
-        transform.translate(player.x - cameraOffset, player.y + (player.animFrame * 0.01f), 0.0f);
-        transform.scale(player.width, player.height, 1.0f);
-        glUniformMatrix4fv(transformLoc, 1, GL_FALSE, transform.m);
-        glUniform4f(colorLocation, 0.0f, 0.0f, 1.0f, 1.0f); // Blue player
-        glBindVertexArray(VAO);                             // Make sure to bind the rectangular VAO before drawing
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        // Draw player eyes
-        Matrix4 eyeTransform;
-        float eyeDirection = player.facingRight ? 0.02f : -0.02f;
-
-        eyeTransform = Matrix4();
-        eyeTransform.translate(player.x - cameraOffset + eyeDirection, player.y + 0.02f, 0.0f);
-        eyeTransform.scale(0.02f, 0.02f, 1.0f);
-        glUniformMatrix4fv(transformLoc, 1, GL_FALSE, eyeTransform.m);
-        glUniform4f(colorLocation, 1.0f, 1.0f, 1.0f, 1.0f); // White eyes
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        glfwSwapBuffers(window);
-        glfwPollEvents();
     }
 
     // Game over/win messages are now handled inside the loop before restart.
     // No final messages needed here as the loop only exits on ESC.
 
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteVertexArrays(1, &circleVAO);
-    glDeleteBuffers(1, &circleVBO);
-    glDeleteVertexArrays(1, &triangleVAO);
-    glDeleteBuffers(1, &triangleVBO);
-    glDeleteVertexArrays(1, &diamondVAO);
-    glDeleteBuffers(1, &diamondVBO);
-    glDeleteProgram(shaderProgram);
+    simulation.stop();
+    if (!recordPath.empty() && session.inputLog.save(recordPath))
+        std::cout << "\nRecorded " << session.inputLog.tickCount << " ticks to " << recordPath << std::endl;
+
+    frameCapture.finish();
+    gpuProfiler.destroy();
+    if (targetFps > 0.0f)
+        dynamicResolution.destroy();
+    layerCache.destroy();
+    spriteBatch.destroy();
+    meshAtlas.destroy();
+    levelStream.stop();
+    levelFile.close();
 
     glfwTerminate();
     return 0;
 }
 
-// process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
-void processInput(GLFWwindow *window)
+// process all input: query GLFW whether relevant keys are pressed/released this frame
+InputState processInput(GLFWwindow *window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
-    // Player movement
-    if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS)
-    {
-        player.x += MOVEMENT_SPEED;
-        player.facingRight = true;
-    }
-    if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS)
-    {
-        // Only allow moving left if not at the camera's left edge
-        if (player.x > cameraOffset - 0.8f)
-        {
-            player.x -= MOVEMENT_SPEED;
-            player.facingRight = false;
-        }
-    }
-    if ((glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS ||
-         glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) &&
-        !player.isJumping)
-    {
-        player.velocityY = JUMP_FORCE;
-        player.isJumping = true;
-    }
-
-    // Restart game with R key
-    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS)
-    {
-        std::cout << "\nGame manually restarted by R key.\n"; // Optional: feedback
-        restartGame(); // Call the unified restart function
-    }
+    InputState input;
+    input.right = glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS;
+    input.left = glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS;
+    input.jump = glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS ||
+                 glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS;
+    input.restart = glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS;
+    return input;
 }
 
 // glfw: whenever the window size changed this callback function executes
@@ -0,0 +1,184 @@
+// Level compiler: turns a text level into the binary format the game maps.
+//
+//   levelc input.txt output.lvl
+//
+// One entity per line, '#' starts a comment. Values in brackets are optional
+// and default to what the game's own constructors use:
+//
+//   player x y                      start position
+//   flag x y                        end of level
+//   platform x y width height
+//   enemy x y [velocity [patrolLeft patrolRight]]
+//   coin x y [width [height]]
+//   cloud x y [size]
+//   bird x y [speed]
+//   mountain x y width height r g b [a]
+//   tree x y size
+#include "../src/GameObjects.h"
+#include "../src/LevelFormat.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// One section's columns while the file is read
+struct SectionBuilder {
+    std::vector<float> columns[ENEMY_COLUMNS];  // The widest section
+    size_t count = 0;
+
+    void add(const std::vector<float> &values) {
+        for (size_t c = 0; c < values.size(); c++)
+            columns[c].push_back(values[c]);
+        count++;
+    }
+
+    // Columns one after another, the layout a LevelColumns with stride == count reads
+    std::vector<float> flatten(int columnCount) const {
+        std::vector<float> flat;
+        flat.reserve(count * columnCount);
+        for (int c = 0; c < columnCount; c++)
+            flat.insert(flat.end(), columns[c].begin(), columns[c].end());
+        return flat;
+    }
+};
+
+// Fill the optional trailing values of a line from defaults
+bool complete(std::vector<float> &values, size_t required, const std::vector<float> &defaults)
+{
+    if (values.size() < required || values.size() > required + defaults.size())
+        return false;
+    for (size_t i = values.size() - required; i < defaults.size(); i++)
+        values.push_back(defaults[i]);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        std::cout << "usage: levelc input.txt output.lvl" << std::endl;
+        return 1;
+    }
+    std::ifstream in(argv[1]);
+    if (!in)
+    {
+        std::cout << "levelc: cannot read " << argv[1] << std::endl;
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    Rng rng;
+    const Coin coin(0.0f, 0.0f);
+    const Cloud cloud(0.0f, 0.0f, rng);
+    const Bird bird(0.0f, 0.0f);
+    const Player player;
+    const Flag flag(LEVEL_END_X, -0.3f);
+
+    LevelView level;
+    level.playerX = player.x;
+    level.playerY = player.y;
+    level.flagX = flag.x;
+    level.flagY = flag.y;
+    SectionBuilder sections[LEVEL_SECTION_COUNT];
+
+    std::string line;
+    for (int lineNumber = 1; std::getline(in, line); lineNumber++)
+    {
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind))
+            continue;
+        std::vector<float> values;
+        float value;
+        while (fields >> value)
+            values.push_back(value);
+        bool ok = fields.eof();
+
+        if (kind == "player" && ok && values.size() == 2)
+        {
+            level.playerX = values[0];
+            level.playerY = values[1];
+            continue;
+        }
+        if (kind == "flag" && ok && values.size() == 2)
+        {
+            level.flagX = values[0];
+            level.flagY = values[1];
+            continue;
+        }
+
+        int section = LEVEL_SECTION_COUNT;
+        if (kind == "platform")
+        {
+            section = LEVEL_PLATFORMS;
+            ok = ok && complete(values, 4, {});
+        }
+        else if (kind == "enemy")
+        {
+            section = LEVEL_ENEMIES;
+            // Size and animation always take the defaults; patrol bounds default around x
+            ok = ok && values.size() >= 2;
+            if (ok)
+            {
+                const Enemy placed(values[0], values[1]);
+                ok = values.size() != 4 && complete(values, 2, {placed.velocity, placed.patrolLeft, placed.patrolRight});
+                if (ok)
+                    values = {placed.x, placed.y, placed.width, placed.height, values[2], values[3], values[4],
+                              placed.baseScale, placed.zoomAmount, placed.zoomSpeed};
+            }
+        }
+        else if (kind == "coin")
+        {
+            section = LEVEL_COINS;
+            ok = ok && complete(values, 2, {coin.width, coin.height});
+        }
+        else if (kind == "cloud")
+        {
+            section = LEVEL_CLOUDS;
+            ok = ok && complete(values, 2, {cloud.size});
+        }
+        else if (kind == "bird")
+        {
+            section = LEVEL_BIRDS;
+            ok = ok && complete(values, 2, {bird.speed});
+        }
+        else if (kind == "mountain")
+        {
+            section = LEVEL_MOUNTAINS;
+            ok = ok && complete(values, 7, {1.0f});
+        }
+        else if (kind == "tree")
+        {
+            section = LEVEL_TREES;
+            ok = ok && complete(values, 3, {});
+        }
+        if (section == LEVEL_SECTION_COUNT || !ok)
+        {
+            std::cout << "levelc: " << argv[1] << ":" << lineNumber << ": cannot read '" << line << "'" << std::endl;
+            return 1;
+        }
+        sections[section].add(values);
+    }
+
+    std::vector<float> tables[LEVEL_SECTION_COUNT];
+    for (int s = 0; s < LEVEL_SECTION_COUNT; s++)
+    {
+        tables[s] = sections[s].flatten(levelSectionColumns[s]);
+        level.sections[s] = {tables[s].data(), sections[s].count, sections[s].count};
+    }
+    if (!writeLevel(argv[2], level))
+        return 1;
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "levelc: " << argv[2] << ":";
+    for (int s = 0; s < LEVEL_SECTION_COUNT; s++)
+        std::cout << " " << levelSectionNames[s] << " " << sections[s].count;
+    std::cout << " in " << ms << " ms" << std::endl;
+    return 0;
+}